@@ -0,0 +1,196 @@
+/* FlixHabit benchmarks
+   Usage: FlixHabitBench [users]   (default 100,000,000; the thread scaling runs use at most 10,000,000)
+   Configure with -DCMAKE_BUILD_TYPE=Release, timings of an unoptimized build are meaningless. */
+
+#include "UserTable.h"
+#include "GroupBy.h"
+#include "Analytics.h"
+#include "ThreadPool.h"
+#include "UserCsv.h"
+#include "Synthetic.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <sstream>
+
+using namespace std;
+
+
+/* Best wall time of 'repeats' runs, in milliseconds */
+template<typename F>
+double timeMs(F&& run, int repeats = 3)
+{
+    double best = numeric_limits<double>::max();
+    for (int r = 0; r < repeats; ++r)
+    {
+        auto start = chrono::steady_clock::now();
+        run();
+        auto finish = chrono::steady_clock::now();
+        best = min(best, chrono::duration<double, milli>(finish - start).count());
+    }
+    return best;
+}
+
+/* Table holding just the columns the country aggregation reads: 10 countries, log-normal watch times
+   rounded to hundredths of an hour like netflix_users.csv */
+UserTable syntheticCountryTable(size_t n, uint64_t seed)
+{
+    const char* countries[] = { "USA", "UK", "Canada", "India", "Brazil", "Germany", "France", "Japan", "Mexico", "Australia" };
+
+    UserTable table;
+    for (const char* c : countries)   { table.countries.encode(c); }
+
+    table.countryCodes.resize(n);
+    table.watchTimes.resize(n);
+    table.ages.assign(n, 30);
+    table.maxAge = 30;
+
+    mt19937_64 rng(seed);
+    lognormal_distribution<double> hours(5.8, 1.0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        table.countryCodes[i] = (uint16_t)(rng() % 10);
+        table.watchTimes[i] = round(hours(rng) * 100.0) / 100.0;
+    }
+
+    return table;
+}
+
+/* ---------------- Average watch time by country ---------------- */
+void benchAverageWatchTimeByCountry(size_t n)
+{
+    cout << "Generating " << n << " synthetic users..." << endl;
+    UserTable table = syntheticCountryTable(n, 42);
+    unsigned int countries = table.countries.size();
+
+    /* Reference: 64-bit-mantissa accumulation */
+    vector<long double> refSum(countries, 0.0L);
+    vector<uint64_t> refCount(countries, 0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        refSum[table.countryCodes[i]] += table.watchTimes[i];
+        ++refCount[table.countryCodes[i]];
+    }
+
+    auto maxRelativeError = [&](const vector<double>& avg)
+    {
+        double worst = 0.0;
+        for (unsigned int c = 0; c < countries; ++c)
+        {
+            long double ref = refSum[c] / refCount[c];
+            worst = max(worst, (double)(fabsl(avg[c] - ref) / ref));
+        }
+        return worst;
+    };
+
+    auto report = [n](const string& method, unsigned int threads, double ms, double error)
+    {
+        cout << left << setw(28) << method << right << setw(8) << threads
+             << setw(12) << fixed << setprecision(2) << ms
+             << setw(12) << setprecision(1) << n / ms / 1000.0
+             << setw(14) << scientific << setprecision(2) << error << defaultfloat << "\n";
+    };
+
+    cout << left << setw(28) << "method" << right << setw(8) << "threads" << setw(12) << "ms"
+         << setw(12) << "Mrows/s" << setw(14) << "max rel err" << "\n";
+
+    /* Baseline: one thread, plain double accumulation in row order */
+    vector<double> naive(countries);
+    double naiveMs = timeMs([&]() {
+        vector<double> sum(countries, 0.0);
+        vector<uint64_t> count(countries, 0);
+        for (size_t i = 0; i < n; ++i)
+        {
+            sum[table.countryCodes[i]] += table.watchTimes[i];
+            ++count[table.countryCodes[i]];
+        }
+        for (unsigned int c = 0; c < countries; ++c)   { naive[c] = sum[c] / count[c]; }
+    });
+    report("naive double", 1, naiveMs, maxRelativeError(naive));
+
+    /* Engine: thread-local dense accumulators with compensated sums */
+    GroupByQuery query;
+    query.keys = { Column::Country };
+    query.aggregates = { { AggregateOp::Avg, Column::WatchTime } };
+
+    unsigned int hardware = max(1u, thread::hardware_concurrency());
+    for (unsigned int threads = 1; ; threads = min(threads * 2, hardware))
+    {
+        vector<double> avg(countries);
+        double ms = timeMs([&]() {
+            for (const auto& row : groupBy(table, query, threads).rows)   { avg[row.keys[0]] = row.values[0]; }
+        });
+        report("groupBy avg (Neumaier)", threads, ms, maxRelativeError(avg));
+
+        if (threads == hardware)   { break; }
+    }
+}
+
+/* ---------------- Thread scaling ---------------- */
+/* Each kernel on 1, 2, 4, ... hardware threads: generating and parsing on a pool of that size, the group-by
+   and the dashboard scan with that many slices on the shared pool */
+void benchThreadScaling(size_t n)
+{
+    cout << "\nGenerating " << n << " CSV lines..." << endl;
+    SyntheticUsers generator(SyntheticProfile::netflixUsers(), 42);
+    ostringstream text;
+    generator.writeCsv(text, n);
+    string csv = move(text).str();
+    UserTable table = generator.table(n);
+
+    GroupByQuery query;
+    query.keys = { Column::Country, Column::Genre };
+    query.aggregates = { { AggregateOp::Avg, Column::WatchTime }, { AggregateOp::Count, Column::WatchTime } };
+
+    struct Kernel
+    {
+        string name;
+        function<void(unsigned int)> run;
+    };
+    vector<Kernel> kernels = {
+        { "generate table", [&](unsigned int threads) { ThreadPool pool(threads); generator.table(n, pool); } },
+        { "parse CSV",      [&](unsigned int threads) { ThreadPool pool(threads); parseUsersCsv(csv, pool); } },
+        { "groupBy",        [&](unsigned int threads) { groupBy(table, query, threads); } },
+        { "dashboard scan", [&](unsigned int threads) { scanDashboard(table, 10, threads); } },
+        { "recency scan", [&](unsigned int threads) { scanRecency(table, { 7, 30, 90 }, NO_DAY, threads); } },
+    };
+
+    cout << left << setw(28) << "kernel" << right << setw(8) << "threads" << setw(12) << "ms"
+         << setw(12) << "Mrows/s" << setw(12) << "speedup" << "\n";
+
+    unsigned int hardware = ThreadPool::shared().getThreadCount();
+    for (const auto& kernel : kernels)
+    {
+        double oneThreadMs = 0.0;
+        for (unsigned int threads = 1; ; threads = min(threads * 2, hardware))
+        {
+            double ms = timeMs([&]() { kernel.run(threads); });
+            if (threads == 1)   { oneThreadMs = ms; }
+
+            cout << left << setw(28) << kernel.name << right << setw(8) << threads
+                 << setw(12) << fixed << setprecision(2) << ms
+                 << setw(12) << setprecision(1) << n / ms / 1000.0
+                 << setw(12) << setprecision(2) << oneThreadMs / ms << defaultfloat << "\n";
+
+            if (threads == hardware)   { break; }
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t users = argc > 1 ? stoull(argv[1]) : 100000000;
+
+    benchAverageWatchTimeByCountry(users);
+    benchThreadScaling(min<size_t>(users, 10000000));
+
+    return 0;
+}
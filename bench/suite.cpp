@@ -0,0 +1,423 @@
+/* FlixHabit microbenchmark suite
+   Usage: FlixHabitSuite [--sizes=1000,100000,1000000] [--filter=<regex>] [--min-time=<seconds>] [--seed=<n>]
+                         [--out=<file.json>]
+   Every benchmark runs once per dataset size, on synthetic users shaped like netflix_users.csv, and repeats until
+   it has run for --min-time (default 0.5 s). Results print as a table and, with --out, are written as JSON in
+   Google Benchmark's layout, so runs of different versions can be compared with its tools (compare.py).
+   Allocations are counted throughout (MemoryStats): per iteration, and the heap's peak above what the dataset
+   holds, reported as extra columns and as the allocs_per_iter, bytes_allocated_per_iter and peak_heap_bytes
+   counters.
+   Some benchmarks also check what they measure, such as MinHeap/reserve, which fails if a heap reserved up front
+   allocates during its 10M inserts; a failed check stops the run with exit status 1.
+   Configure with -DCMAKE_BUILD_TYPE=Release, timings of an unoptimized build are meaningless. */
+
+#include "UserTable.h"
+#include "UserIndex.h"
+#include "Analytics.h"
+#include "UserAnalytics.h"
+#include "UserCsv.h"
+#include "Synthetic.h"
+#include "PackedUser.h"
+#include "Export.h"
+#include "JsonWriter.h"
+#include "MemoryStats.h"
+#include "MinHeap.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <functional>
+#include <regex>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+
+/* Results are folded into this so the compiler cannot drop the work that produced them */
+volatile uint64_t sink = 0;
+
+/* Stream buffer that only counts what is written to it */
+class CountingBuffer : public streambuf
+{
+    private:
+
+        uint64_t count = 0;
+
+    protected:
+
+        int overflow(int c) override                           { ++count; return c; }
+        streamsize xsputn(const char*, streamsize n) override   { count += n; return n; }
+
+    public:
+
+        uint64_t getCount() const   { return count; }
+};
+
+/* ---------------- Datasets ---------------- */
+/* Everything the benchmarks of one size read, prepared before any of them is timed */
+struct Dataset
+{
+    size_t size = 0;
+    vector<User> users;
+    PackedUsers packed;
+    int64_t usersHeapBytes;             /* live heap the users took, as vector<User> and packed */
+    int64_t packedHeapBytes;
+    UserTable table;
+    UserIndex index;
+    vector<UserSimilarity> sims;
+    Graph genreGraph;
+    DashboardScan scan;
+    RecencyScan recency;
+    filesystem::path csv;               /* the users written as a CSV file, removed with the dataset */
+
+    Dataset(size_t size, uint64_t seed) : size(size)
+    {
+        SyntheticUsers generator(SyntheticProfile::netflixUsers(), seed);
+        int64_t before = MemoryStats::counters().liveBytes;
+        users = generator.generate(size);
+        int64_t afterUsers = MemoryStats::counters().liveBytes;
+        packed = PackedUsers(users);
+        usersHeapBytes = afterUsers - before;
+        packedHeapBytes = MemoryStats::counters().liveBytes - afterUsers;
+        table = buildUserTable(users);
+        index = buildUserIndex(table);
+        sims = findMostSimilarUsers(users, 100);
+        genreGraph = buildUserGenreGraph(users);
+        scan = scanDashboard(table, 10);
+        recency = scanRecency(table);
+
+        csv = filesystem::temp_directory_path() / ("flixhabit-suite-" + to_string(size) + ".csv");
+        ofstream out(csv, ios::binary);
+        generator.writeCsv(out, size);
+    }
+
+    ~Dataset()
+    {
+        error_code ignored;
+        filesystem::remove(csv, ignored);
+    }
+};
+
+/* ---------------- Benchmarks ---------------- */
+/* What one iteration processed: items for items_per_second, bytes for bytes_per_second */
+struct Work
+{
+    uint64_t items;
+    uint64_t bytes = 0;
+};
+
+struct Benchmark
+{
+    string name;                                        /* the dataset size is appended as "/<size>" */
+    function<Work(const Dataset&)> run;
+};
+
+/* Run emit into a JsonWriter that counts the bytes it writes */
+Work writeJson(uint64_t items, const function<void(JsonWriter&)>& emit)
+{
+    CountingBuffer counter;
+    ostream out(&counter);
+    {
+        JsonWriter writer(out);
+        emit(writer);
+    }
+    sink = sink + counter.getCount();
+    return { items, counter.getCount() };
+}
+
+vector<Benchmark> benchmarks()
+{
+    return {
+        { "readUsersFromCSV", [](const Dataset& d) -> Work {
+            vector<User> users = readUsersFromCSV(d.csv.string());
+            sink = sink + users.size();
+            return { users.size(), filesystem::file_size(d.csv) };
+        } },
+        { "PackedUsers/pack", [](const Dataset& d) -> Work {
+            PackedUsers packed(d.users);
+            sink = sink + packed.size();
+            return { d.size };
+        } },
+        { "PackedUsers/unpack", [](const Dataset& d) -> Work {
+            sink = sink + d.packed.unpackAll().size();
+            return { d.size };
+        } },
+        { "calculateSimilarity", [](const Dataset& d) -> Work {
+            /* Each user against the one after it */
+            double total = 0.0;
+            for (size_t i = 0; i < d.size; ++i)   { total += calculateSimilarity(d.users[i], d.users[(i + 1) % d.size]); }
+            sink = sink + (uint64_t)total;
+            return { d.size };
+        } },
+        { "findMostSimilarUsers", [](const Dataset& d) -> Work {
+            vector<UserSimilarity> sims = findMostSimilarUsers(d.users, 10);
+            sink = sink + sims.size();
+            size_t n = min<size_t>(d.size, 100);
+            return { n * (n - 1) / 2 };
+        } },
+        { "findMostActiveUsers/heap", [](const Dataset& d) -> Work {
+            sink = sink + findMostActiveUsers(d.users, 10).size();
+            return { d.size };
+        } },
+        { "findMostActiveUsers/parallel", [](const Dataset& d) -> Work {
+            sink = sink + findMostActiveUsersParallel(d.users, 10).size();
+            return { d.size };
+        } },
+        { "findMostActiveUsers/graph", [](const Dataset& d) -> Work {
+            sink = sink + findMostActiveUsersByGraph(d.users, 10).size();
+            return { d.size };
+        } },
+        { "findMostActiveUsers/index", [](const Dataset& d) -> Work {
+            sink = sink + d.index.byWatchTime.top(10).size();
+            return { 10 };
+        } },
+        { "MinHeap/reserve", [](const Dataset&) -> Work {
+            /* The similarity search sizes its heaps up front: once reserved, a heap must not allocate however
+               many elements go in, in whatever order */
+            const unsigned int inserts = 10000000;
+            MinHeap<UserSimilarity> heap;
+            heap.reserve(inserts);
+
+            MemoryCounters before = MemoryStats::counters();
+            uint64_t state = 1;
+            for (unsigned int i = 0; i < inserts; ++i)
+            {
+                state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                heap.insert({ (int)i, (int)(i + 1), (double)(state >> 11) / (1ULL << 53) });
+            }
+            uint64_t allocations = MemoryStats::counters().allocations - before.allocations;
+
+            if (allocations > 0)
+               { throw logic_error("MinHeap allocated " + to_string(allocations) + " times after reserve()"); }
+            if (heap.getSize() != inserts)   { throw logic_error("MinHeap lost elements"); }
+            sink = sink + (uint64_t)(heap.getMin().similarity * 1e6);
+            return { inserts };
+        } },
+        { "buildUserGenreGraph", [](const Dataset& d) -> Work {
+            Graph graph = buildUserGenreGraph(d.users);
+            sink = sink + graph.getAdjList().size();
+            return { d.size };
+        } },
+        { "findAverageWatchTimeByCountry", [](const Dataset& d) -> Work {
+            sink = sink + findAverageWatchTimeByCountry(d.table).size();
+            return { d.size };
+        } },
+        { "scanRecency", [](const Dataset& d) -> Work {
+            sink = sink + scanRecency(d.table).activeWithin[0];
+            return { d.size, d.size * sizeof(int32_t) };
+        } },
+        { "writeUsers", [](const Dataset& d) -> Work {
+            return writeJson(d.size, [&](JsonWriter& writer) { writeUsers(writer, d.users); });
+        } },
+        { "writeSimilarities", [](const Dataset& d) -> Work {
+            return writeJson(d.sims.size(), [&](JsonWriter& writer) {
+                writeSimilarities(writer, d.sims, d.users, d.table, d.index.byUserID);
+            });
+        } },
+        { "writeGraph", [](const Dataset& d) -> Work {
+            return writeJson(d.genreGraph.getAdjList().size(), [&](JsonWriter& writer) { writeGraph(writer, d.genreGraph); });
+        } },
+        { "writeDashboard", [](const Dataset& d) -> Work {
+            return writeJson(d.size, [&](JsonWriter& writer) {
+                writeDashboard(writer, d.scan, d.recency, d.sims, d.users, d.table, d.index.byUserID);
+            });
+        } },
+    };
+}
+
+/* ---------------- Runner ---------------- */
+struct Result
+{
+    string name;
+    size_t size;
+    uint64_t iterations;
+    double realNs;                      /* per iteration */
+    double cpuNs;                       /* per iteration, every thread of the process */
+    Work work;
+    double allocations;                 /* per iteration */
+    double bytesAllocated;              /* per iteration */
+    int64_t peakHeapBytes;              /* above the heap in use before the first iteration */
+};
+
+/* Repeat the benchmark until it has run for minSeconds, and at least once */
+Result measure(const Benchmark& benchmark, const Dataset& dataset, double minSeconds)
+{
+    Result result{ benchmark.name + "/" + to_string(dataset.size), dataset.size, 0, 0.0, 0.0, { 0 }, 0.0, 0.0, 0 };
+
+    MemoryStats::resetPeak();
+    MemoryCounters memoryStart = MemoryStats::counters();
+    auto start = chrono::steady_clock::now();
+    clock_t cpuStart = clock();
+    double elapsed = 0.0;
+    while (result.iterations == 0 || elapsed < minSeconds)
+    {
+        result.work = benchmark.run(dataset);
+        ++result.iterations;
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    double cpuSeconds = (double)(clock() - cpuStart) / CLOCKS_PER_SEC;
+    MemoryCounters memoryEnd = MemoryStats::counters();
+
+    result.realNs = elapsed * 1e9 / result.iterations;
+    result.cpuNs = cpuSeconds * 1e9 / result.iterations;
+    result.allocations = (double)(memoryEnd.allocations - memoryStart.allocations) / result.iterations;
+    result.bytesAllocated = (double)(memoryEnd.bytesAllocated - memoryStart.bytesAllocated) / result.iterations;
+    result.peakHeapBytes = memoryEnd.peakLiveBytes - memoryStart.liveBytes;
+    return result;
+}
+
+void printResult(const Result& r)
+{
+    cout << left << setw(44) << r.name << right << fixed << setprecision(0)
+         << setw(16) << r.realNs << setw(16) << r.cpuNs << setw(12) << r.iterations
+         << setw(14) << setprecision(1) << r.allocations << setw(14) << r.bytesAllocated / 1024
+         << setw(14) << r.peakHeapBytes / 1024.0
+         << setw(14) << setprecision(2) << r.work.items / (r.realNs / 1e9) / 1e6;
+    if (r.work.bytes > 0)   { cout << setw(12) << setprecision(1) << r.work.bytes / (r.realNs / 1e9) / (1 << 20); }
+    cout << defaultfloat << "\n";
+}
+
+/* The layout of Google Benchmark's --benchmark_out JSON, with the dataset size as a "users" counter */
+void writeResults(const string& path, const vector<Result>& results, uint64_t seed, double minSeconds,
+                  const string& executable)
+{
+    ofstream out(path);
+    JsonWriter writer(out);
+
+    time_t now = time(nullptr);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+    writer.beginObject();
+    writer.key("context");
+    writer.beginObject();
+    writer.member("date", date);
+    writer.member("executable", executable);
+    writer.member("num_cpus", (uint64_t)max(1u, thread::hardware_concurrency()));
+#ifdef NDEBUG
+    writer.member("library_build_type", "release");
+#else
+    writer.member("library_build_type", "debug");
+#endif
+    writer.member("seed", seed);
+    writer.member("min_time", minSeconds);
+    writer.endObject();
+
+    writer.key("benchmarks");
+    writer.beginArray();
+    for (const auto& r : results)
+    {
+        writer.beginObject();
+        writer.member("name", r.name);
+        writer.member("run_name", r.name);
+        writer.member("run_type", "iteration");
+        writer.member("repetitions", (uint64_t)1);
+        writer.member("repetition_index", (uint64_t)0);
+        writer.member("threads", (uint64_t)1);
+        writer.member("iterations", r.iterations);
+        writer.member("real_time", r.realNs);
+        writer.member("cpu_time", r.cpuNs);
+        writer.member("time_unit", "ns");
+        writer.member("items_per_second", r.work.items / (r.realNs / 1e9));
+        if (r.work.bytes > 0)   { writer.member("bytes_per_second", r.work.bytes / (r.realNs / 1e9)); }
+        writer.member("users", (uint64_t)r.size);
+        writer.member("allocs_per_iter", r.allocations);
+        writer.member("bytes_allocated_per_iter", r.bytesAllocated);
+        writer.member("peak_heap_bytes", r.peakHeapBytes);
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+    writer.flush();
+    out << "\n";
+}
+
+int main(int argc, char* argv[])
+{
+    vector<size_t> sizes = { 1000, 100000, 1000000 };
+    regex filter(".*");
+    double minSeconds = 0.5;
+    uint64_t seed = 42;
+    string outPath;
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            string arg = argv[i];
+            size_t equals = arg.find('=');
+            string name = arg.substr(0, equals);
+            string value = equals == string::npos ? "" : arg.substr(equals + 1);
+
+            if (name == "--sizes")
+            {
+                sizes.clear();
+                stringstream list(value);
+                for (string size; getline(list, size, ',');)   { sizes.push_back(stoull(size)); }
+            }
+            else if (name == "--filter")     { filter = regex(value); }
+            else if (name == "--min-time")   { minSeconds = stod(value); }
+            else if (name == "--seed")       { seed = stoull(value); }
+            else if (name == "--out")        { outPath = value; }
+            else                             { throw invalid_argument("unknown option " + arg); }
+        }
+    }
+    catch (const exception& e)
+    {
+        cerr << "FlixHabitSuite: " << e.what() << "\n"
+             << "Usage: FlixHabitSuite [--sizes=N,N,...] [--filter=<regex>] [--min-time=<seconds>] [--seed=<n>] "
+                "[--out=<file.json>]\n";
+        return 2;
+    }
+
+    vector<Benchmark> selected;
+    for (auto& benchmark : benchmarks())
+    {
+        if (regex_search(benchmark.name, filter))   { selected.push_back(move(benchmark)); }
+    }
+
+    cout << left << setw(44) << "benchmark" << right << setw(16) << "real ns" << setw(16) << "cpu ns"
+         << setw(12) << "iterations" << setw(14) << "allocs/iter" << setw(14) << "KiB alloc/it"
+         << setw(14) << "peak heap KiB" << setw(14) << "Mitems/s" << setw(12) << "MiB/s" << "\n";
+
+    MemoryStats::enable();
+    vector<Result> results;
+    try
+    {
+        for (size_t size : sizes)
+        {
+            if (size == 0 || selected.empty())   { continue; }
+
+            Dataset dataset(size, seed);
+            cout << "# " << size << " users: " << fixed << setprecision(1) << dataset.usersHeapBytes / 1048576.0
+                 << " MiB of heap as User, " << dataset.packedHeapBytes / 1048576.0 << " MiB packed" << defaultfloat << "\n";
+            for (const auto& benchmark : selected)
+            {
+                results.push_back(measure(benchmark, dataset, minSeconds));
+                printResult(results.back());
+            }
+        }
+    }
+    catch (const logic_error& e)
+    {
+        cout << flush;
+        cerr << "FlixHabitSuite: check failed: " << e.what() << "\n";
+        return 1;
+    }
+
+    if (outPath.empty() == false)
+    {
+        writeResults(outPath, results, seed, minSeconds, argv[0]);
+        cout << "Results written to " << outPath << "\n";
+    }
+
+    return 0;
+}
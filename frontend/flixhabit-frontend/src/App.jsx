@@ -44,6 +44,7 @@ export default function App() {
   const [basic, setBasic] = useState([]);
   const [standard, setStandard] = useState([]);
   const [premium, setPremium] = useState([]);
+  const [userTotals, setUserTotals] = useState({});
   const [activeUsers, setActiveUsers] = useState([]);
   const [loading, setLoading] = useState(true);
   const [error, setError] = useState(null);
@@ -89,37 +90,100 @@ export default function App() {
       return res.json();
     };
 
+    // A subscription list is either one file or pages listed in a manifest. With a manifest only the first
+    // page is fetched up front; loadRest() appends the others one by one afterwards.
+    const fetchUserList = async (name, setUsers) => {
+      let manifest = null;
+      try {
+        const res = await fetch(`/data/${name}.manifest.json`);
+        if (res.ok) manifest = await res.json();
+      } catch {
+        manifest = null;
+      }
+      if (!manifest || !Array.isArray(manifest.pages)) {
+        return { users: await fetchJson(`${name}.json`), loadRest: async () => {} };
+      }
+
+      setUserTotals((totals) => ({ ...totals, [name]: manifest.count }));
+      const [first, ...rest] = manifest.pages;
+      const users = first ? await fetchJson(first.file) : [];
+      const loadRest = async () => {
+        for (const page of rest) {
+          const more = await fetchJson(page.file);
+          setUsers((current) => [...current, ...more]);
+        }
+      };
+      return { users, loadRest };
+    };
+
+    // The bundle written by "Build dashboard" holds every view in one file; without it (or with a layout this
+    // page does not know) each view comes from its own export.
+    const DASHBOARD_BUNDLE_VERSION = 1;
+    const fetchBundle = async () => {
+      try {
+        const res = await fetch("/data/dashboard.json");
+        if (!res.ok) return null;
+        const bundle = await res.json();
+        return bundle.version === DASHBOARD_BUNDLE_VERSION ? bundle : null;
+      } catch {
+        return null;
+      }
+    };
+
+    const fetchSeparately = async () => {
+      const [
+        buckets,
+        watch,
+        pairs,
+        basicU,
+        standardU,
+        premiumU,
+        activeU,
+      ] = await Promise.all([
+        fetchJson("genreForAgeGroup.json"),
+        fetchJson("avgWatchTimeByCountry.json"),
+        fetchJson("similar_users.json"),
+        fetchUserList("Basic_users", setBasic),
+        fetchUserList("Standard_users", setStandard),
+        fetchUserList("Premium_users", setPremium).catch(() => ({ users: [], loadRest: async () => {} })),
+        fetchJson("topActive_users.json"),
+      ]);
+      return { buckets, watch, pairs, basicU, standardU, premiumU, activeU };
+    };
+
+    const fromBundle = (bundle) => {
+      const list = (plan) => ({ users: bundle.subscriptions?.[plan] ?? [], loadRest: async () => {} });
+      return {
+        buckets: bundle.genreForAgeGroup,
+        watch: bundle.avgWatchTimeByCountry,
+        pairs: bundle.similarUsers,
+        basicU: list("Basic"),
+        standardU: list("Standard"),
+        premiumU: list("Premium"),
+        activeU: bundle.topActiveUsers,
+      };
+    };
+
     const loadData = async () => {
       setLoading(true);
       setError(null);
       try {
-        const [
-          buckets,
-          watch,
-          pairs,
-          basicU,
-          standardU,
-          premiumU,
-          activeU,
-        ] = await Promise.all([
-          fetchJson("genreForAgeGroup.json"),
-          fetchJson("avgWatchTimeByCountry.json"),
-          fetchJson("similar_users.json"),
-          fetchJson("basic_users.json"),
-          fetchJson("Standard_users.json"),
-          fetchJson("Premium_users.json").catch(() => []),
-          fetchJson("topActive_users.json"),
-        ]);
+        const bundle = await fetchBundle();
+        const { buckets, watch, pairs, basicU, standardU, premiumU, activeU } =
+          bundle ? fromBundle(bundle) : await fetchSeparately();
 
         await new Promise(resolve => setTimeout(resolve, 800));
 
         setAgeBuckets(buckets);
         setWatchTime(watch);
         setSimilarPairs(pairs);
-        setBasic(basicU);
-        setStandard(standardU);
-        setPremium(premiumU);
+        setBasic(basicU.users);
+        setStandard(standardU.users);
+        setPremium(premiumU.users);
         setActiveUsers(activeU);
+
+        [basicU, standardU, premiumU].forEach((list) =>
+          list.loadRest().catch((e) => console.error("Error fetching user pages:", e)));
       } catch (e) {
         console.error("Error fetching dashboard data:", e);
         setError(e.message || "Failed to load dashboard data.");
@@ -137,9 +201,9 @@ export default function App() {
   }));
 
   const subCounts = [
-    { tier: "Basic", count: basic.length, icon: <Users className="h-6 w-6" />, color: "from-blue-500 to-blue-600", shadowColor: "shadow-blue-500/30" },
-    { tier: "Standard", count: standard.length, icon: <Star className="h-6 w-6" />, color: "from-purple-500 to-purple-600", shadowColor: "shadow-purple-500/30" },
-    { tier: "Premium", count: premium.length, icon: <Activity className="h-6 w-6" />, color: "from-red-500 to-red-600", shadowColor: "shadow-red-500/30" },
+    { tier: "Basic", count: userTotals.Basic_users ?? basic.length, icon: <Users className="h-6 w-6" />, color: "from-blue-500 to-blue-600", shadowColor: "shadow-blue-500/30" },
+    { tier: "Standard", count: userTotals.Standard_users ?? standard.length, icon: <Star className="h-6 w-6" />, color: "from-purple-500 to-purple-600", shadowColor: "shadow-purple-500/30" },
+    { tier: "Premium", count: userTotals.Premium_users ?? premium.length, icon: <Activity className="h-6 w-6" />, color: "from-red-500 to-red-600", shadowColor: "shadow-red-500/30" },
   ];
 
   const containerVariants = {
@@ -422,7 +486,7 @@ export default function App() {
                                       {i + 1}
                                     </div>
                                     <span className="text-xs sm:text-sm text-neutral-200">
-                                      User {p.user1ID} &amp; {p.user2ID}
+                                      {p.user1?.name ?? `User ${p.user1ID}`} &amp; {p.user2?.name ?? `User ${p.user2ID}`}
                                     </span>
                                   </div>
                                   <div className="flex items-baseline gap-1 rounded-md bg-red-500/10 px-2 py-1 text-xs">
@@ -0,0 +1,356 @@
+#include "Analytics.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+
+/* ---------------- Age x Genre Histogram ---------------- */
+
+AgeGenreHistogram buildAgeGenreHistogram(const UserTable& table, unsigned int threadCount)
+{
+    AgeGenreHistogram hist;
+    hist.maxAge = table.maxAge;
+    hist.genreCount = table.genres.size();
+    hist.counts.assign((size_t)(hist.maxAge + 1) * hist.genreCount, 0);
+
+    GroupByQuery query;
+    query.keys = { Column::Age, Column::Genre };
+    query.aggregates = { { AggregateOp::Count } };
+    query.where = { RowFilter::between(Column::Age, 0, hist.maxAge) };
+
+    for (const auto& row : groupBy(table, query, threadCount).rows)
+    {
+        hist.counts[(size_t)row.keys[0] * hist.genreCount + row.keys[1]] = (unsigned int)row.count;
+    }
+
+    return hist;
+}
+
+int AgeGenreHistogram::mostCommonGenre(int minAge, int maxAge, const Dictionary& genres) const
+{
+    minAge = max(minAge, 0);
+    maxAge = min(maxAge, this->maxAge);
+
+    int best = -1;
+    unsigned int bestCount = 0;
+
+    for (unsigned int g = 0; g < genreCount; ++g)
+    {
+        unsigned int total = 0;
+        for (int age = minAge; age <= maxAge; ++age)   { total += counts[(size_t)age * genreCount + g]; }
+
+        if (total == 0)   { continue; }
+
+        if (total > bestCount
+            || (total == bestCount && genres.decode(g) < genres.decode(best)))
+        {
+            best = g;
+            bestCount = total;
+        }
+    }
+
+    return best;
+}
+
+vector<pair<string, string>> genreByAgeGroup(const AgeGenreHistogram& hist, const Dictionary& genres,
+                                             int minAge, int maxAge, int width)
+{
+    vector<pair<string, string>> groups;
+    for (int lo = minAge; lo < maxAge; lo += width)
+    {
+        int genre = hist.mostCommonGenre(lo, lo + width, genres);
+        groups.push_back({ to_string(lo) + "-" + to_string(lo + width), genre < 0 ? "" : genres.decode(genre) });
+    }
+    return groups;
+}
+
+string findMostCommonGenreForAgeGroup(const UserTable& table, int minAge, int maxAge)
+{
+    GroupByQuery query;
+    query.aggregates = { { AggregateOp::Mode, Column::Genre } };
+    query.where = { RowFilter::between(Column::Age, minAge, maxAge) };
+
+    GroupByResult result = groupBy(table, query);
+    if (result.rows.empty())   { return ""; }
+
+    return table.genres.decode((uint16_t)result.rows[0].values[0]);
+}
+
+
+/* ---------------- Watch Time by Country ---------------- */
+
+map<string, double> findAverageWatchTimeByCountry(const UserTable& table)
+{
+    GroupByQuery query;
+    query.keys = { Column::Country };
+    query.aggregates = { { AggregateOp::Avg, Column::WatchTime } };
+
+    map<string, double> avgWatchTime;
+    for (const auto& row : groupBy(table, query).rows)
+    {
+        avgWatchTime[table.countries.decode(row.keys[0])] = row.values[0];
+    }
+
+    return avgWatchTime;
+}
+
+
+/* ---------------- Subscription Filter ---------------- */
+
+RowBitmap findUsersBySubscription(const UserTable& table, const BitmapIndex& index, const string& subscriptionType)
+{
+    int code = table.subscriptions.find(subscriptionType);
+    if (code < 0)   { return RowBitmap(); }
+
+    return index.rowsWith(Column::Subscription, code);
+}
+
+
+/* ---------------- Login Recency ---------------- */
+
+RecencyScan scanRecency(const UserTable& table, const vector<unsigned int>& windows, int32_t referenceDay,
+                        unsigned int threadCount)
+{
+    const size_t BLOCK_ROWS = 1024;
+
+    /* Days back of a row without a login date: beyond every window and bucket */
+    const uint32_t UNDATED = UINT32_MAX;
+
+    TraceSpan span("recency.scan");
+    size_t n = table.size();
+    unsigned int countryCount = table.countries.size();
+    unsigned int genreCount = table.genres.size();
+    unsigned int subscriptionCount = table.subscriptions.size();
+
+    RecencyScan scan;
+    scan.windows = windows;
+    scan.referenceDay = referenceDay == NO_DAY ? table.lastLoginDay : referenceDay;
+
+    /* The month of every day from the first login to the last, as an index into scan.months */
+    vector<uint32_t> monthOfDay;
+    if (table.firstLoginDay != NO_DAY)
+    {
+        int firstYear;
+        unsigned int firstMonth;
+        yearMonthOfDay(table.firstLoginDay, firstYear, firstMonth);
+
+        for (int32_t day = table.firstLoginDay; day <= table.lastLoginDay; ++day)
+        {
+            int year;
+            unsigned int month;
+            yearMonthOfDay(day, year, month);
+
+            size_t index = (size_t)((year - firstYear) * 12 + (int)month - (int)firstMonth);
+            if (index == scan.months.size())
+            {
+                char label[16];
+                snprintf(label, sizeof(label), "%04d-%02u", year, month);
+                scan.months.push_back(label);
+            }
+            monthOfDay.push_back((uint32_t)index);
+        }
+    }
+    size_t monthCount = scan.months.size();
+
+    /* Windows past the undated marker would take the undated rows in */
+    vector<uint32_t> limits;
+    for (unsigned int days : windows)   { limits.push_back(min<uint32_t>(days, UNDATED - 1)); }
+
+    struct Partial
+    {
+        vector<uint64_t> activeWithin;
+        uint64_t undated = 0;
+        vector<uint64_t> countryMonths;
+        vector<uint64_t> genreMonths;
+        vector<uint64_t> churnRisk;
+    };
+
+    threadCount = scanThreadCount(n, threadCount);
+    size_t chunk = (n + threadCount - 1) / threadCount;
+    vector<Partial> partials(threadCount);
+
+    auto runSlice = [&](unsigned int t)
+    {
+        TraceSpan slice("recency.slice");
+        Partial& p = partials[t];
+        p.activeWithin.assign(limits.size(), 0);
+        p.countryMonths.assign(countryCount * monthCount, 0);
+        p.genreMonths.assign(genreCount * monthCount, 0);
+        p.churnRisk.assign(subscriptionCount * CHURN_BUCKETS, 0);
+
+        uint32_t since[BLOCK_ROWS];
+        size_t begin = min(n, t * chunk);
+        size_t end = min(n, begin + chunk);
+        for (size_t blockStart = begin; blockStart < end; blockStart += BLOCK_ROWS)
+        {
+            size_t m = min(end, blockStart + BLOCK_ROWS) - blockStart;
+            const int32_t* days = table.loginDays.data() + blockStart;
+
+            /* Days back from the reference day, in 64 bits so NO_DAY cannot overflow */
+            for (size_t j = 0; j < m; ++j)
+            {
+                int64_t back = max<int64_t>((int64_t)scan.referenceDay - days[j], 0);
+                since[j] = days[j] == NO_DAY ? UNDATED : (uint32_t)min<int64_t>(back, UNDATED - 1);
+            }
+
+            for (size_t w = 0; w < limits.size(); ++w)
+            {
+                uint32_t limit = limits[w];
+                uint64_t count = 0;
+                for (size_t j = 0; j < m; ++j)   { count += since[j] <= limit; }
+                p.activeWithin[w] += count;
+            }
+
+            uint64_t undated = 0;
+            for (size_t j = 0; j < m; ++j)   { undated += since[j] == UNDATED; }
+            p.undated += undated;
+
+            /* A row's bucket is the number of bucket bounds its login lies beyond */
+            const uint16_t* plans = table.subscriptionCodes.data() + blockStart;
+            for (size_t j = 0; j < m; ++j)
+            {
+                unsigned int bucket = (since[j] > CHURN_BUCKET_DAYS[0]) + (since[j] > CHURN_BUCKET_DAYS[1])
+                                    + (since[j] > CHURN_BUCKET_DAYS[2]);
+                if (since[j] != UNDATED)   { ++p.churnRisk[(size_t)plans[j] * CHURN_BUCKETS + bucket]; }
+            }
+
+            if (monthCount == 0)   { continue; }
+            const uint16_t* countries = table.countryCodes.data() + blockStart;
+            const uint16_t* genres = table.genreCodes.data() + blockStart;
+            for (size_t j = 0; j < m; ++j)
+            {
+                if (days[j] == NO_DAY)   { continue; }
+                uint32_t month = monthOfDay[days[j] - table.firstLoginDay];
+                ++p.countryMonths[countries[j] * monthCount + month];
+                ++p.genreMonths[genres[j] * monthCount + month];
+            }
+        }
+    };
+
+    parallelFor(0, threadCount, 1, [&](size_t lo, size_t) { runSlice((unsigned int)lo); });
+
+    Partial& total = partials[0];
+    for (unsigned int t = 1; t < threadCount; ++t)
+    {
+        Partial& p = partials[t];
+        for (size_t w = 0; w < limits.size(); ++w)   { total.activeWithin[w] += p.activeWithin[w]; }
+        total.undated += p.undated;
+        for (size_t c = 0; c < total.countryMonths.size(); ++c)   { total.countryMonths[c] += p.countryMonths[c]; }
+        for (size_t c = 0; c < total.genreMonths.size(); ++c)   { total.genreMonths[c] += p.genreMonths[c]; }
+        for (size_t c = 0; c < total.churnRisk.size(); ++c)   { total.churnRisk[c] += p.churnRisk[c]; }
+    }
+
+    scan.activeWithin = move(total.activeWithin);
+    scan.undated = total.undated;
+    scan.countryMonths = move(total.countryMonths);
+    scan.genreMonths = move(total.genreMonths);
+    scan.churnRisk = move(total.churnRisk);
+    return scan;
+}
+
+
+/* ---------------- Dashboard ---------------- */
+
+DashboardScan scanDashboard(const UserTable& table, unsigned int topK, unsigned int threadCount)
+{
+    TraceSpan span("dashboard.scan");
+    size_t n = table.size();
+    unsigned int genreCount = table.genres.size();
+    unsigned int countryCount = table.countries.size();
+    unsigned int subscriptionCount = table.subscriptions.size();
+    size_t cells = (size_t)(table.maxAge + 1) * genreCount;
+
+    struct Partial
+    {
+        vector<unsigned int> ageGenre;
+        vector<CompensatedSum> countryWatchTime;
+        vector<uint64_t> countryUsers;
+        vector<vector<uint32_t>> subscriptionRows;
+        FixedMinHeap<RowWatch> active;
+    };
+
+    threadCount = scanThreadCount(n, threadCount);
+    size_t chunk = (n + threadCount - 1) / threadCount;
+    vector<Partial> partials(threadCount);
+
+    auto runSlice = [&](unsigned int t)
+    {
+        TraceSpan slice("dashboard.slice");
+        Partial& p = partials[t];
+        p.ageGenre.assign(cells, 0);
+        p.countryWatchTime.resize(countryCount);
+        p.countryUsers.assign(countryCount, 0);
+        p.subscriptionRows.resize(subscriptionCount);
+        p.active = FixedMinHeap<RowWatch>(topK);
+
+        size_t begin = min(n, t * chunk);
+        size_t end = min(n, begin + chunk);
+        for (size_t row = begin; row < end; ++row)
+        {
+            int age = table.ages[row];
+            if (age >= 0)   { ++p.ageGenre[(size_t)age * genreCount + table.genreCodes[row]]; }
+
+            uint16_t country = table.countryCodes[row];
+            p.countryWatchTime[country].add(table.watchTimes[row]);
+            ++p.countryUsers[country];
+
+            p.subscriptionRows[table.subscriptionCodes[row]].push_back((uint32_t)row);
+
+            if (topK > 0)   { p.active.insert({ table.watchTimes[row], table.userIDs[row], (uint32_t)row }); }
+        }
+    };
+
+    parallelFor(0, threadCount, 1, [&](size_t lo, size_t) { runSlice((unsigned int)lo); });
+
+    /* Fold the later slices into the first, in order, the way groupBy merges its partials */
+    Partial& total = partials[0];
+    for (unsigned int t = 1; t < threadCount; ++t)
+    {
+        Partial& p = partials[t];
+        for (size_t c = 0; c < cells; ++c)   { total.ageGenre[c] += p.ageGenre[c]; }
+        for (unsigned int c = 0; c < countryCount; ++c)
+        {
+            total.countryWatchTime[c].add(p.countryWatchTime[c].sum);
+            total.countryWatchTime[c].add(p.countryWatchTime[c].compensation);
+            total.countryUsers[c] += p.countryUsers[c];
+        }
+        for (unsigned int s = 0; s < subscriptionCount; ++s)
+        {
+            auto& rows = total.subscriptionRows[s];
+            rows.insert(rows.end(), p.subscriptionRows[s].begin(), p.subscriptionRows[s].end());
+        }
+    }
+
+    DashboardScan scan;
+    scan.ageGenre.maxAge = table.maxAge;
+    scan.ageGenre.genreCount = genreCount;
+    scan.ageGenre.counts = move(total.ageGenre);
+    scan.countryWatchTime = move(total.countryWatchTime);
+    scan.countryUsers = move(total.countryUsers);
+    scan.subscriptionRows = move(total.subscriptionRows);
+
+    vector<FixedMinHeap<RowWatch>> heaps;
+    for (auto& p : partials)   { heaps.push_back(move(p.active)); }
+    FixedMinHeap<RowWatch> active = reduceHeaps(heaps);
+    while (active.empty() == false)
+    {
+        scan.topActiveRows.push_back(active.getMin().row);
+        active.removeMin();
+    }
+    reverse(scan.topActiveRows.begin(), scan.topActiveRows.end());
+
+    return scan;
+}
+
+map<string, double> DashboardScan::averageWatchTimeByCountry(const UserTable& table) const
+{
+    map<string, double> avgWatchTime;
+    for (unsigned int c = 0; c < countryUsers.size(); ++c)
+    {
+        if (countryUsers[c] > 0)   { avgWatchTime[table.countries.decode(c)] = countryWatchTime[c].value() / countryUsers[c]; }
+    }
+    return avgWatchTime;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "UserTable.h"
+#include "GroupBy.h"
+#include "UserIndex.h"
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/* The menu's analyses, each a query on the group-by engine */
+
+/* ---------------- Age x Genre Histogram (option 3) ---------------- */
+struct AgeGenreHistogram
+{
+    int maxAge = -1;                /* ages above this (and negative ages) were not seen */
+    unsigned int genreCount = 0;
+    vector<unsigned int> counts;    /* counts[age * genreCount + genreCode] */
+
+    /* Most common genre code among users aged minAge..maxAge inclusive, -1 if there are none.
+       Ties go to the alphabetically first genre name, like the map-based scan. */
+    int mostCommonGenre(int minAge, int maxAge, const Dictionary& genres) const;
+};
+
+/* Count every user into its [age][genre] cell in a single scan; threadCount 0 uses every hardware thread */
+AgeGenreHistogram buildAgeGenreHistogram(const UserTable& table, unsigned int threadCount = 0);
+
+/* ("lo-hi", most common genre) for the age groups minAge-minAge+width, ... up to maxAge, with "" for a group
+   without users. Both ends of a group count, so neighbouring groups share their boundary age. */
+vector<pair<string, string>> genreByAgeGroup(const AgeGenreHistogram& hist, const Dictionary& genres,
+                                             int minAge = 15, int maxAge = 80, int width = 5);
+
+/* Most common genre among users aged minAge..maxAge inclusive, "" if there are none */
+string findMostCommonGenreForAgeGroup(const UserTable& table, int minAge, int maxAge);
+
+/* ---------------- Watch Time by Country (option 4) ---------------- */
+map<string, double> findAverageWatchTimeByCountry(const UserTable& table);
+
+/* ---------------- Subscription Filter (option 7) ---------------- */
+/* Rows of the users on the given plan, straight from the bitmap index */
+RowBitmap findUsersBySubscription(const UserTable& table, const BitmapIndex& index, const string& subscriptionType);
+
+/* ---------------- Login Recency (option 14) ---------------- */
+/* Churn-risk buckets by days since the last login: up to 7, 8-30, 31-90 and over 90 */
+const unsigned int CHURN_BUCKETS = 4;
+const unsigned int CHURN_BUCKET_DAYS[CHURN_BUCKETS - 1] = { 7, 30, 90 };
+const char* const CHURN_BUCKET_NAMES[CHURN_BUCKETS] = { "active", "cooling", "atRisk", "churned" };
+
+/* How recently the users logged in, from the table's loginDays column. Days are counted back from a reference
+   day, by default the latest login in the data: the CSV is a snapshot, so the wall clock would put everyone
+   out of every window. Logins after the reference day count as on it. Users without a login date are only
+   counted in 'undated'. */
+struct RecencyScan
+{
+    int32_t referenceDay = NO_DAY;
+    vector<unsigned int> windows;               /* days, as asked for */
+    vector<uint64_t> activeWithin;              /* by window: users whose last login is at most that many days back */
+    uint64_t undated = 0;
+
+    vector<string> months;                      /* "YYYY-MM", every month from the first login to the last */
+    vector<uint64_t> countryMonths;             /* [countryCode * months.size() + month] */
+    vector<uint64_t> genreMonths;               /* [genreCode * months.size() + month] */
+    vector<uint64_t> churnRisk;                 /* [subscriptionCode * CHURN_BUCKETS + bucket] */
+};
+
+/* One pass over the date column, a block of rows at a time: the days since the last login first, then a
+   branch-free counting loop per window and per bucket over them, which the compiler turns into SIMD. Slices
+   run on the shared ThreadPool like scanDashboard's. */
+RecencyScan scanRecency(const UserTable& table, const vector<unsigned int>& windows = { 7, 30, 90 },
+                        int32_t referenceDay = NO_DAY, unsigned int threadCount = 0);
+
+/* ---------------- Dashboard (option 13) ---------------- */
+/* Everything the dashboard's user aggregates need, gathered in one scan of the table rather than one per menu
+   option. Each slice of the rows is a task on the shared ThreadPool filling private counters; the partials are merged in slice
+   order, so every figure equals the one the separate analysis would give. */
+struct DashboardScan
+{
+    AgeGenreHistogram ageGenre;
+    vector<CompensatedSum> countryWatchTime;    /* by country code */
+    vector<uint64_t> countryUsers;              /* by country code */
+    vector<vector<uint32_t>> subscriptionRows;  /* by subscription code, ascending */
+    vector<uint32_t> topActiveRows;             /* the k highest watch times, most active first */
+
+    /* Same as findAverageWatchTimeByCountry */
+    map<string, double> averageWatchTimeByCountry(const UserTable& table) const;
+};
+
+/* topK users are kept for topActiveRows; threadCount 0 uses every hardware thread */
+DashboardScan scanDashboard(const UserTable& table, unsigned int topK, unsigned int threadCount = 0);
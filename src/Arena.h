@@ -0,0 +1,30 @@
+#pragma once
+
+#include <memory_resource>
+#include <cstddef>
+
+using namespace std;
+
+/* ---------------- Scratch Arena ---------------- */
+/* The first bytes of an arena, inside the object itself, so a small operation never reaches the heap.
+   A separate base so it is constructed before the resource that points into it. */
+template<size_t InlineBytes>
+struct ArenaBuffer
+{
+    alignas(max_align_t) byte inlineBuffer[InlineBytes];
+};
+
+/* One bump region for an operation's temporaries. Containers built on it (pmr::vector, pmr::set, ...) take
+   their memory from the inline buffer, then from heap blocks that grow geometrically; freeing a single
+   allocation does nothing, and everything goes back at once when the arena is destroyed. The containers must
+   not outlive it. Not thread-safe: give every thread of a parallel operation its own. */
+template<size_t InlineBytes = 4096>
+class ScratchArena : private ArenaBuffer<InlineBytes>, public pmr::monotonic_buffer_resource
+{
+    public:
+
+        ScratchArena() : pmr::monotonic_buffer_resource(this->inlineBuffer, InlineBytes) {}
+
+        ScratchArena(const ScratchArena&) = delete;
+        ScratchArena& operator=(const ScratchArena&) = delete;
+};
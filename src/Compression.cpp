@@ -0,0 +1,159 @@
+#include "Compression.h"
+#include "Trace.h"
+#include <zlib.h>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+static const int GZIP_WINDOW_BITS = 15 + 16;       /* largest window, gzip wrapper instead of zlib's */
+static const size_t CHUNK_BYTES = 1 << 16;      /* read from the source and written out at a time */
+
+
+string gzipCompress(string_view data, int level)
+{
+    z_stream zs{};
+    if (deflateInit2(&zs, level, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+       { throw runtime_error("deflateInit2 failed"); }
+
+    string out(deflateBound(&zs, data.size()), '\0');
+    zs.next_in = (Bytef*)data.data();
+    zs.avail_in = (uInt)data.size();
+    zs.next_out = (Bytef*)out.data();
+    zs.avail_out = (uInt)out.size();
+
+    int status = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+
+    if (status != Z_STREAM_END)   { throw runtime_error("deflate failed"); }
+    return out;
+}
+
+
+/* ---------------- Background Compressor ---------------- */
+
+BackgroundCompressor::BackgroundCompressor(int level) : level(level)
+{
+    worker = thread(&BackgroundCompressor::run, this);
+}
+
+BackgroundCompressor::~BackgroundCompressor()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void BackgroundCompressor::compress(const filesystem::path& source, const filesystem::path& target)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        tasks.push_back({ source, target });
+        ++unfinished;
+    }
+    wake.notify_one();
+}
+
+void BackgroundCompressor::wait()
+{
+    unique_lock<mutex> guard(lock);
+    idle.wait(guard, [this]() { return unfinished == 0; });
+}
+
+int BackgroundCompressor::pending() const
+{
+    lock_guard<mutex> guard(lock);
+    return unfinished;
+}
+
+void BackgroundCompressor::run()
+{
+    Trace::setThreadName("gzip");
+
+    while (true)
+    {
+        Task task;
+        {
+            unique_lock<mutex> guard(lock);
+            /* Once asked to stop, keep going until the queue is drained, so every file handed over is completed */
+            wake.wait(guard, [this]() { return tasks.empty() == false || stopping; });
+            if (tasks.empty())   { return; }
+            task = move(tasks.front());
+            tasks.pop_front();
+        }
+
+        compressFile(task);
+
+        {
+            lock_guard<mutex> guard(lock);
+            --unfinished;
+        }
+        idle.notify_all();
+    }
+}
+
+void BackgroundCompressor::compressFile(const Task& task)
+{
+    /* A source deleted before its turn was abandoned by its writer */
+    ifstream in(task.source, ios::binary);
+    if (!in)   { return; }
+
+    TraceSpan span("gzip.compress");
+    filesystem::path temp = filesystem::path(task.target) += ".tmp";
+    ofstream out(temp, ios::out | ios::binary);
+    z_stream zs{};
+    bool ok = out.good() && deflateInit2(&zs, level, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+
+    vector<char> input(CHUNK_BYTES);
+    vector<char> output(CHUNK_BYTES);
+    int flush = Z_NO_FLUSH;
+    while (ok && flush != Z_FINISH)
+    {
+        in.read(input.data(), CHUNK_BYTES);
+        size_t got = (size_t)in.gcount();
+        if (in.bad())   { ok = false; break; }
+        flush = in.eof() ? Z_FINISH : Z_NO_FLUSH;
+        bytesIn += got;
+        span.addBytes(got);
+
+        /* Output space left over means deflate has taken all the input (and, with Z_FINISH, ended the stream) */
+        zs.next_in = (Bytef*)input.data();
+        zs.avail_in = (uInt)got;
+        do
+        {
+            zs.next_out = (Bytef*)output.data();
+            zs.avail_out = CHUNK_BYTES;
+            deflate(&zs, flush);
+            size_t produced = CHUNK_BYTES - zs.avail_out;
+            out.write(output.data(), (streamsize)produced);
+            bytesOut += produced;
+        }
+        while (zs.avail_out == 0);
+    }
+    deflateEnd(&zs);                    /* harmless on a stream deflateInit2 never set up */
+    out.close();
+    ok = ok && out.good();
+
+    error_code error;
+    if (ok)   { filesystem::rename(temp, task.target, error); }
+    if (ok == false || error)
+    {
+        filesystem::remove(temp, error);
+        if (filesystem::exists(task.source, error))   { ++failures; }
+        return;
+    }
+
+    /* The source went away while it was compressed: its .gz must not outlive it. Deleting the source before its
+       .gz, as Exporter does, then leaves nothing behind whichever of the two gets there first. */
+    if (filesystem::exists(task.source, error) == false)
+    {
+        filesystem::remove(task.target, error);
+        return;
+    }
+    ++filesDone;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <cstdint>
+
+using namespace std;
+
+/* gzip (RFC 1952) compression of export files with zlib */
+
+/* The whole input as one gzip member; the header carries no name or timestamp, so equal input gives equal bytes */
+string gzipCompress(string_view data, int level = 6);
+
+/* ---------------- Background Compressor ---------------- */
+/* Compresses finished files on a worker thread. The caller writes a file at full speed and hands it over once it
+   is complete; the worker reads it back in chunks (usually still in the page cache) and writes "<target>.tmp",
+   renamed into place once complete, so a reader never sees a truncated .gz. The caller never waits for
+   compression and the memory held does not grow with the file. A source that is deleted before its turn, or
+   while it is compressed, leaves no .gz behind. */
+class BackgroundCompressor
+{
+    private:
+
+        struct Task
+        {
+            filesystem::path source;
+            filesystem::path target;
+        };
+
+        int level;
+        deque<Task> tasks;
+        int unfinished = 0;             /* files handed over whose .gz is not yet written */
+        bool stopping = false;
+        mutable mutex lock;
+        condition_variable wake;        /* worker: tasks queued or stopping */
+        condition_variable idle;        /* wait(): a file finished */
+        thread worker;
+
+        atomic<uint64_t> bytesIn{ 0 };
+        atomic<uint64_t> bytesOut{ 0 };
+        atomic<unsigned int> filesDone{ 0 };
+        atomic<unsigned int> failures{ 0 };
+
+        void run();
+        void compressFile(const Task& task);
+
+    public:
+
+        explicit BackgroundCompressor(int level = 6);
+
+        /* Finishes every file already handed over, then stops the worker */
+        ~BackgroundCompressor();
+
+        BackgroundCompressor(const BackgroundCompressor&) = delete;
+        BackgroundCompressor& operator=(const BackgroundCompressor&) = delete;
+
+        /* Gzip the complete file at 'source' into 'target'; returns at once */
+        void compress(const filesystem::path& source, const filesystem::path& target);
+
+        /* Block until every file handed over so far is on disk */
+        void wait();
+
+        /* Files handed over but not yet written */
+        int pending() const;
+
+        uint64_t getBytesIn() const             { return bytesIn; }
+        uint64_t getBytesOut() const            { return bytesOut; }
+        unsigned int getFilesDone() const       { return filesDone; }
+        unsigned int getFailures() const        { return failures; }
+};
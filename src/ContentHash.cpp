@@ -0,0 +1,147 @@
+#include "ContentHash.h"
+#include <cstring>
+#include <algorithm>
+#include <bit>
+
+using namespace std;
+
+/* Constants and rounds of the XXH64 specification */
+static const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+static uint64_t read64(const unsigned char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;               /* little-endian hosts only, like the rest of the binary formats here */
+}
+
+static uint32_t read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint64_t xxRound(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME2;
+    acc = rotl(acc, 31);
+    return acc * PRIME1;
+}
+
+static uint64_t mergeRound(uint64_t acc, uint64_t lane)
+{
+    acc ^= xxRound(0, lane);
+    return acc * PRIME1 + PRIME4;
+}
+
+
+ContentHash::ContentHash(uint64_t seed) : seed(seed)
+{
+    lanes[0] = seed + PRIME1 + PRIME2;
+    lanes[1] = seed + PRIME2;
+    lanes[2] = seed;
+    lanes[3] = seed - PRIME1;
+}
+
+void ContentHash::consumeStripe(const unsigned char* p)
+{
+    for (int lane = 0; lane < 4; ++lane)   { lanes[lane] = xxRound(lanes[lane], read64(p + 8 * lane)); }
+}
+
+void ContentHash::update(const void* data, size_t n)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    total += n;
+
+    /* Top up a partial stripe first */
+    if (stripeUsed > 0)
+    {
+        size_t take = min(n, sizeof(stripe) - stripeUsed);
+        memcpy(stripe + stripeUsed, p, take);
+        stripeUsed += take;
+        p += take;
+        n -= take;
+        if (stripeUsed < sizeof(stripe))   { return; }
+        consumeStripe(stripe);
+        stripeUsed = 0;
+    }
+
+    for (; n >= 32; p += 32, n -= 32)   { consumeStripe(p); }
+
+    memcpy(stripe, p, n);
+    stripeUsed = n;
+}
+
+uint64_t ContentHash::digest() const
+{
+    uint64_t h;
+    if (total >= 32)
+    {
+        h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+        for (int lane = 0; lane < 4; ++lane)   { h = mergeRound(h, lanes[lane]); }
+    }
+    else
+    {
+        h = seed + PRIME5;
+    }
+    h += total;
+
+    const unsigned char* p = stripe;
+    size_t n = stripeUsed;
+    for (; n >= 8; p += 8, n -= 8)
+    {
+        h ^= xxRound(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+    }
+    if (n >= 4)
+    {
+        h ^= (uint64_t)read32(p) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+        n -= 4;
+    }
+    for (; n > 0; ++p, --n)
+    {
+        h ^= (*p) * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+string ContentHash::hex() const
+{
+    static const char digits[] = "0123456789abcdef";
+    uint64_t h = digest();
+    string out(16, '0');
+    for (int i = 15; i >= 0; --i, h >>= 4)   { out[i] = digits[h & 15]; }
+    return out;
+}
+
+
+/* ---------------- Hashing Buffer ---------------- */
+
+HashingBuffer::int_type HashingBuffer::overflow(int_type c)
+{
+    if (traits_type::eq_int_type(c, traits_type::eof()))   { return traits_type::not_eof(c); }
+
+    char ch = traits_type::to_char_type(c);
+    hash.update(&ch, 1);
+    return target->sputc(ch);
+}
+
+streamsize HashingBuffer::xsputn(const char* s, streamsize n)
+{
+    hash.update(s, (size_t)n);
+    return target->sputn(s, n);
+}
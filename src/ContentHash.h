@@ -0,0 +1,59 @@
+#pragma once
+
+#include <streambuf>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/* ---------------- Content Hash ---------------- */
+/* XXH64, a fast non-cryptographic 64-bit hash, fed incrementally: splitting the input into chunks differently
+   gives the same digest as hashing it in one go. Good for telling whether a file changed; useless against
+   deliberate collisions. */
+class ContentHash
+{
+    private:
+
+        uint64_t seed;
+        uint64_t lanes[4];
+        unsigned char stripe[32];       /* input not yet consumed as a full 32-byte stripe */
+        size_t stripeUsed = 0;
+        uint64_t total = 0;
+
+        void consumeStripe(const unsigned char* p);
+
+    public:
+
+        explicit ContentHash(uint64_t seed = 0);
+
+        void update(const void* data, size_t n);
+        uint64_t digest() const;
+
+        /* Bytes hashed so far */
+        uint64_t size() const   { return total; }
+
+        /* digest() as 16 lowercase hex digits */
+        string hex() const;
+};
+
+/* Stream buffer that passes everything to another buffer and hashes it on the way. Unbuffered itself: put a
+   buffering writer such as JsonWriter in front of it. */
+class HashingBuffer : public streambuf
+{
+    private:
+
+        streambuf* target;
+        ContentHash hash;
+
+    protected:
+
+        int_type overflow(int_type c) override;
+        streamsize xsputn(const char* s, streamsize n) override;
+
+    public:
+
+        explicit HashingBuffer(streambuf* target) : target(target) {}
+
+        const ContentHash& getHash() const   { return hash; }
+};
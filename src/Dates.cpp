@@ -0,0 +1,74 @@
+#include "Dates.h"
+#include <cstdio>
+
+using namespace std;
+
+
+int32_t daysFromCivil(int year, unsigned int month, unsigned int day)
+{
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    unsigned int yoe = (unsigned int)(year - era * 400);
+    unsigned int doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+/* Year, month and day of a day number */
+static void civil(int32_t days, int& year, unsigned int& month, unsigned int& day)
+{
+    days += 719468;
+    int era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned int doe = (unsigned int)(days - era * 146097);
+    unsigned int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned int mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = (int)yoe + era * 400 + (month <= 2);
+}
+
+string civilFromDays(int32_t days)
+{
+    int year;
+    unsigned int month, day;
+    civil(days, year, month, day);
+
+    /* Month and day always take two digits, but the buffer has room for any int and unsigned, as the compiler
+       cannot tell that */
+    char text[11 + 1 + 10 + 1 + 10 + 1];
+    snprintf(text, sizeof(text), "%04d-%02u-%02u", year, month, day);
+    return text;
+}
+
+void yearMonthOfDay(int32_t days, int& year, unsigned int& month)
+{
+    unsigned int day;
+    civil(days, year, month, day);
+}
+
+int32_t parseDay(string_view date)
+{
+    if (date.size() != 10 || date[4] != '-' || date[7] != '-')   { return NO_DAY; }
+
+    /* Digits of YYYYMMDD; as unsigned, any other character comes out above 9 */
+    static const unsigned char positions[8] = { 0, 1, 2, 3, 5, 6, 8, 9 };
+    unsigned int d[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        d[i] = (unsigned int)(date[positions[i]] - '0');
+        if (d[i] > 9)   { return NO_DAY; }
+    }
+
+    int year = (int)(d[0] * 1000 + d[1] * 100 + d[2] * 10 + d[3]);
+    unsigned int month = d[4] * 10 + d[5];
+    unsigned int day = d[6] * 10 + d[7];
+
+    static const unsigned char monthDays[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    if (month < 1 || month > 12 || day < 1 || day > monthDays[month - 1])   { return NO_DAY; }
+
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    if (month == 2 && day == 29 && leap == false)   { return NO_DAY; }
+
+    return daysFromCivil(year, month, day);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+/* ---------------- Day Numbers ---------------- */
+/* Dates as days since 1970-01-01 in the proleptic Gregorian calendar (Howard Hinnant's algorithms), so they
+   sort, subtract and bucket as plain integers */
+
+/* The day number of no date: lastLogin was empty or not a YYYY-MM-DD date */
+const int32_t NO_DAY = INT32_MIN;
+
+int32_t daysFromCivil(int year, unsigned int month, unsigned int day);
+
+/* "YYYY-MM-DD" of a day number */
+string civilFromDays(int32_t days);
+
+/* Year and month (1-12) of a day number */
+void yearMonthOfDay(int32_t days, int& year, unsigned int& month);
+
+/* The day number of exactly "YYYY-MM-DD", read digit by digit without locale or strptime; NO_DAY for anything
+   else, including dates that do not exist such as 2025-02-29 */
+int32_t parseDay(string_view date);
@@ -0,0 +1,582 @@
+#include "Export.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "Arena.h"
+#include <set>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <atomic>
+#include <nlohmann/json.hpp>
+
+using namespace std;
+
+
+/* ---------------- Users ---------------- */
+
+void writeUser(JsonWriter& writer, const User& user)
+{
+    writer.beginObject();
+    writer.member("age", user.age);
+    writer.member("country", user.country);
+    writer.member("genre", user.genre);
+    writer.member("lastLogin", user.lastLogin);
+    writer.member("name", user.name);
+    writer.member("subscription", user.subscription);
+    writer.member("userID", user.userID);
+    writer.member("watchTime", user.watchTime);
+    writer.endObject();
+}
+
+void writeUsers(JsonWriter& writer, const vector<User>& users)
+{
+    writer.beginArray(users.size());
+    for (const auto& user : users)   { writeUser(writer, user); }
+    writer.endArray();
+}
+
+void writeUsers(JsonWriter& writer, const vector<User>& users, const RowBitmap& rows)
+{
+    writer.beginArray(rows.cardinality());
+    rows.forEach([&](uint32_t row) { writeUser(writer, users[row]); });
+    writer.endArray();
+}
+
+void writeUsers(JsonWriter& writer, const vector<User>& users, span<const uint32_t> rows)
+{
+    writer.beginArray(rows.size());
+    for (uint32_t row : rows)   { writeUser(writer, users[row]); }
+    writer.endArray();
+}
+
+
+/* ---------------- Similar Pairs ---------------- */
+
+void writeSimilarities(JsonWriter& writer, const vector<UserSimilarity>& sims, const vector<User>& users,
+                       const UserTable& table, const UserIdIndex& byUserID)
+{
+    writer.beginArray(sims.size());
+    for (const auto& s : sims)
+    {
+        long long row1 = byUserID.find(table, s.user1ID);
+        long long row2 = byUserID.find(table, s.user2ID);
+
+        writer.beginObject();
+        writer.member("similarity", s.similarity);
+        if (row1 >= 0)
+        {
+            writer.key("user1");
+            writeUser(writer, users[row1]);
+        }
+        writer.member("user1ID", s.user1ID);
+        if (row2 >= 0)
+        {
+            writer.key("user2");
+            writeUser(writer, users[row2]);
+        }
+        writer.member("user2ID", s.user2ID);
+        writer.endObject();
+    }
+    writer.endArray();
+}
+
+
+/* ---------------- Genre Graph ---------------- */
+
+void writeGraph(JsonWriter& writer, const Graph& graph)
+{
+    const auto& adjList = graph.getAdjList();
+
+    writer.beginObject();
+
+    writer.key("edges");
+    writer.beginArray();
+
+    /* Every edge is listed at both ends; the pairs seen are views of the graph's own names */
+    ScratchArena<> arena;
+    pmr::set<pair<string_view, string_view>> seen(&arena);
+    for (const auto& kv : adjList)
+    {
+        for (const auto& nbr : kv.second)
+        {
+            auto [first, second] = minmax(kv.first, nbr);
+            if (seen.emplace(first, second).second)
+            {
+                writer.beginObject();
+                writer.member("from", kv.first);
+                writer.member("to", nbr);
+                writer.endObject();
+            }
+        }
+    }
+    writer.endArray();
+
+    writer.key("nodes");
+    writer.beginArray();
+    for (const auto& kv : adjList)
+    {
+        writer.beginObject();
+        writer.member("id", kv.first);
+        writer.member("label", kv.first);
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.endObject();
+}
+
+
+/* ---------------- Aggregates ---------------- */
+
+void writeGenreByAgeGroup(JsonWriter& writer, const vector<pair<string, string>>& groups)
+{
+    size_t filled = count_if(groups.begin(), groups.end(), [](const auto& g) { return g.second.empty() == false; });
+
+    writer.beginArray(filled);
+    for (const auto& [ageRange, genre] : groups)
+    {
+        if (genre.empty())   { continue; }
+        writer.beginObject();
+        writer.member("ageRange", ageRange);
+        writer.member("genre", genre);
+        writer.endObject();
+    }
+    writer.endArray();
+}
+
+void writeAverageWatchTime(JsonWriter& writer, const map<string, double>& averages)
+{
+    writer.beginObject();
+    for (const auto& [country, hours] : averages)   { writer.member(country, hours); }
+    writer.endObject();
+}
+
+
+/* ---------------- Login Recency ---------------- */
+
+/* Codes of a dictionary in the order of their names */
+static pmr::map<string_view, uint16_t> byName(const Dictionary& dictionary, pmr::memory_resource* arena)
+{
+    pmr::map<string_view, uint16_t> codes(arena);
+    for (unsigned int code = 0; code < dictionary.size(); ++code)   { codes[dictionary.decode(code)] = code; }
+    return codes;
+}
+
+void writeRecency(JsonWriter& writer, const RecencyScan& scan, const UserTable& table)
+{
+    /* The churn buckets by name */
+    const unsigned int BUCKETS_BY_NAME[CHURN_BUCKETS] = { 0, 2, 3, 1 };
+
+    ScratchArena<> arena;
+    size_t monthCount = scan.months.size();
+
+    writer.beginObject();
+
+    writer.key("activeWithin");
+    writer.beginArray(scan.windows.size());
+    for (size_t w = 0; w < scan.windows.size(); ++w)
+    {
+        writer.beginObject();
+        writer.member("days", (uint64_t)scan.windows[w]);
+        writer.member("users", scan.activeWithin[w]);
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.key("churnRisk");
+    writer.beginObject();
+    for (const auto& [plan, code] : byName(table.subscriptions, &arena))
+    {
+        writer.key(plan);
+        writer.beginObject();
+        for (unsigned int bucket : BUCKETS_BY_NAME)
+           { writer.member(CHURN_BUCKET_NAMES[bucket], scan.churnRisk[(size_t)code * CHURN_BUCKETS + bucket]); }
+        writer.endObject();
+    }
+    writer.endObject();
+
+    /* One array of per-month counts for each value of a column */
+    auto monthsBy = [&](const Dictionary& dictionary, const vector<uint64_t>& counts) {
+        writer.beginObject();
+        for (const auto& [name, code] : byName(dictionary, &arena))
+        {
+            writer.key(name);
+            writer.beginArray(monthCount);
+            for (size_t m = 0; m < monthCount; ++m)   { writer.value(counts[(size_t)code * monthCount + m]); }
+            writer.endArray();
+        }
+        writer.endObject();
+    };
+
+    writer.key("loginMonths");
+    writer.beginObject();
+    writer.key("byCountry");
+    monthsBy(table.countries, scan.countryMonths);
+    writer.key("byGenre");
+    monthsBy(table.genres, scan.genreMonths);
+    writer.key("months");
+    writer.beginArray(monthCount);
+    for (const auto& month : scan.months)   { writer.value(month); }
+    writer.endArray();
+    writer.endObject();
+
+    writer.key("referenceDate");
+    if (scan.referenceDay == NO_DAY)   { writer.null(); }
+    else                               { writer.value(civilFromDays(scan.referenceDay)); }
+
+    writer.member("undated", scan.undated);
+    writer.endObject();
+}
+
+
+/* ---------------- Dashboard Bundle ---------------- */
+
+void writeDashboard(JsonWriter& writer, const DashboardScan& scan, const RecencyScan& recency,
+                    const vector<UserSimilarity>& sims, const vector<User>& users, const UserTable& table,
+                    const UserIdIndex& byUserID)
+{
+    writer.beginObject();
+
+    writer.key("avgWatchTimeByCountry");
+    writeAverageWatchTime(writer, scan.averageWatchTimeByCountry(table));
+
+    writer.key("genreForAgeGroup");
+    writeGenreByAgeGroup(writer, genreByAgeGroup(scan.ageGenre, table.genres));
+
+    writer.key("recency");
+    writeRecency(writer, recency, table);
+
+    writer.key("similarUsers");
+    writeSimilarities(writer, sims, users, table, byUserID);
+
+    /* Plans in name order, like the keys of every other object */
+    ScratchArena<> arena;
+    writer.key("subscriptions");
+    writer.beginObject();
+    for (const auto& [plan, code] : byName(table.subscriptions, &arena))
+    {
+        writer.key(plan);
+        writeUsers(writer, users, scan.subscriptionRows[code]);
+    }
+    writer.endObject();
+
+    writer.key("topActiveUsers");
+    writeUsers(writer, users, scan.topActiveRows);
+
+    writer.member("userCount", (uint64_t)users.size());
+    writer.member("version", DASHBOARD_BUNDLE_VERSION);
+    writer.endObject();
+}
+
+
+/* ---------------- ETag Manifest ---------------- */
+
+ETagManifest::ETagManifest(const filesystem::path& path) : path(path)
+{
+    ifstream file(path);
+    if (!file)   { return; }
+
+    /* A sidecar that cannot be read only costs one rewrite of every export */
+    nlohmann::json saved = nlohmann::json::parse(file, nullptr, false);
+    if (saved.is_object() == false)   { return; }
+
+    generation = saved.value("generation", (uint64_t)0);
+    if (saved.contains("files") && saved["files"].is_object())
+    {
+        for (auto& [name, entry] : saved["files"].items())
+        {
+            if (entry.is_object() == false)   { continue; }
+            files[name] = { entry.value("etag", string()), entry.value("size", (uint64_t)0) };
+        }
+    }
+}
+
+ETagManifest::~ETagManifest()
+{
+    flush();
+}
+
+string ETagManifest::keyFor(const filesystem::path& file) const
+{
+    return filesystem::absolute(file).lexically_relative(filesystem::absolute(path).parent_path()).generic_string();
+}
+
+bool ETagManifest::unchanged(const filesystem::path& file, const string& etag, uint64_t size) const
+{
+    {
+        lock_guard<mutex> guard(lock);
+        auto it = files.find(keyFor(file));
+        if (it == files.end() || it->second.etag != etag || it->second.size != size)   { return false; }
+    }
+
+    /* Someone may have deleted or edited the file behind our back */
+    error_code error;
+    uint64_t onDisk = filesystem::file_size(file, error);
+    return !error && onDisk == size;
+}
+
+void ETagManifest::record(const filesystem::path& file, const string& etag, uint64_t size)
+{
+    lock_guard<mutex> guard(lock);
+    files[keyFor(file)] = { etag, size };
+    ++generation;
+    dirty = true;
+}
+
+void ETagManifest::forget(const filesystem::path& file)
+{
+    lock_guard<mutex> guard(lock);
+    if (files.erase(keyFor(file)) == 0)   { return; }
+    ++generation;
+    dirty = true;
+}
+
+void ETagManifest::flush()
+{
+    lock_guard<mutex> guard(lock);
+    if (dirty && save())   { dirty = false; }
+}
+
+uint64_t ETagManifest::getGeneration() const
+{
+    lock_guard<mutex> guard(lock);
+    return generation;
+}
+
+bool ETagManifest::save() const
+{
+    filesystem::path temp = filesystem::path(path) += ".tmp";
+    error_code error;
+    filesystem::create_directories(path.parent_path(), error);
+    {
+        ofstream file(temp);
+        JsonWriter writer(file);
+        writer.beginObject();
+        writer.key("files");
+        writer.beginObject();
+        for (auto& [name, entry] : files)
+        {
+            writer.key(name);
+            writer.beginObject();
+            writer.member("etag", entry.etag);
+            writer.member("size", entry.size);
+            writer.endObject();
+        }
+        writer.endObject();
+        writer.member("generation", generation);
+        writer.endObject();
+        writer.flush();
+        file.put('\n');
+        if (!file)
+        {
+            cerr << "Cannot write " << filesystem::absolute(temp) << '\n';
+            filesystem::remove(temp, error);
+            return false;
+        }
+    }
+    filesystem::rename(temp, path, error);
+    if (error)   { cerr << "Cannot replace " << filesystem::absolute(path) << ": " << error.message() << '\n'; }
+    return !error;
+}
+
+
+/* ---------------- Export Files ---------------- */
+
+filesystem::path Exporter::pathFor(filesystem::path path) const
+{
+    return path.replace_extension(exportFormatExtension(format));
+}
+
+bool Exporter::write(const filesystem::path& path, const function<void(JsonWriter&)>& emit, bool trailingNewline) const
+{
+    bool ok = writeFile(path, emit, trailingNewline);
+    flushETags();
+    return ok;
+}
+
+void Exporter::flushETags() const
+{
+    if (etags != nullptr)   { etags->flush(); }
+}
+
+bool Exporter::writeFile(const filesystem::path& path, const function<void(JsonWriter&)>& emit, bool trailingNewline) const
+{
+    TraceSpan trace("export.write");
+    filesystem::path target = pathFor(path);
+    filesystem::path temp = filesystem::path(target) += ".tmp";
+    filesystem::path gzPath = filesystem::path(target) += ".gz";
+    filesystem::create_directories(target.parent_path());
+
+    ofstream file(temp, isBinaryFormat(format) ? ios::out | ios::binary : ios::out);
+    if (!file)
+    {
+        cerr << "Cannot open " << filesystem::absolute(temp) << '\n';
+        return false;
+    }
+
+    /* file <- hashing <- writer */
+    HashingBuffer hashing(file.rdbuf());
+    ostream out(&hashing);
+
+    try
+    {
+        JsonWriter writer(out, format);
+        emit(writer);
+        writer.flush();
+        if (trailingNewline && isBinaryFormat(format) == false && format != ExportFormat::NDJson)   { out.put('\n'); }
+    }
+    catch (...)
+    {
+        /* Drop the partial file, then let the caller see what went wrong */
+        file.close();
+        error_code ignored;
+        filesystem::remove(temp, ignored);
+        throw;
+    }
+    file.close();
+
+    error_code error;
+    if (!file || !out)
+    {
+        cerr << "Cannot write " << filesystem::absolute(temp) << '\n';
+        filesystem::remove(temp, error);
+        return false;
+    }
+
+    string etag = hashing.getHash().hex();
+    uint64_t size = hashing.getHash().size();
+    trace.addBytes(size);
+    bool changed = etags == nullptr || etags->unchanged(target, etag, size) == false;
+
+    if (changed)
+    {
+        filesystem::rename(temp, target, error);
+        if (error)
+        {
+            cerr << "Cannot replace " << filesystem::absolute(target) << ": " << error.message() << '\n';
+            filesystem::remove(temp, error);
+            return false;
+        }
+        if (etags != nullptr)   { etags->record(target, etag, size); }
+    }
+    else
+    {
+        filesystem::remove(temp, error);
+    }
+
+    /* The .gz is made from the file in place; an unchanged file keeps its existing one, unless that has gone missing */
+    if (compressor != nullptr && (changed || filesystem::exists(gzPath) == false))   { compressor->compress(target, gzPath); }
+    return true;
+}
+
+/* Delete an export file and its gzip sibling and forget their hashes */
+static void removeExport(const filesystem::path& target, ETagManifest* etags)
+{
+    error_code ignored;
+    filesystem::remove(target, ignored);
+    filesystem::remove(filesystem::path(target) += ".gz", ignored);
+    if (etags != nullptr)   { etags->forget(target); }
+}
+
+void Exporter::remove(const filesystem::path& path) const
+{
+    removeExport(pathFor(path), etags);
+    flushETags();
+}
+
+void Exporter::removeAllFormats(const filesystem::path& path, bool exceptThisFormat) const
+{
+    /* Compact JSON shares the .json extension, so it has no files of its own */
+    for (ExportFormat each : { ExportFormat::Json, ExportFormat::NDJson, ExportFormat::Cbor, ExportFormat::MessagePack })
+    {
+        string extension = exportFormatExtension(each);
+        if (exceptThisFormat && extension == exportFormatExtension(format))   { continue; }
+        removeExport(filesystem::path(path).replace_extension(extension), etags);
+    }
+    flushETags();
+}
+
+bool Exporter::writeUserList(const filesystem::path& path, const vector<User>& users, const RowBitmap& rows) const
+{
+    TraceSpan trace("export.userList");
+    filesystem::path pagesDir = path.parent_path() / path.stem();
+    filesystem::path manifest = path.parent_path() / (path.stem().string() + ".manifest.json");
+    error_code ignored;
+
+    /* A list that changes layout leaves the other layout behind in whatever format it was written in */
+    if (pageSize == 0)
+    {
+        removeAllFormats(manifest);
+        /* Removing the directory fails while the compressor is still writing a page's .gz into it */
+        if (compressor != nullptr && filesystem::is_directory(pagesDir, ignored))   { compressor->wait(); }
+        if (etags != nullptr && filesystem::is_directory(pagesDir, ignored))
+        {
+            for (auto& entry : filesystem::directory_iterator(pagesDir, ignored))   { etags->forget(entry.path()); }
+        }
+        filesystem::remove_all(pagesDir, ignored);
+        return write(path, [&](JsonWriter& writer) { writeUsers(writer, users, rows); });
+    }
+
+    removeAllFormats(path);
+    removeAllFormats(manifest, true);
+    filesystem::create_directories(pagesDir);
+
+    vector<uint32_t> ids = rows.toRows();
+    size_t pages = (ids.size() + pageSize - 1) / pageSize;
+    auto pageFile = [&](size_t page) { return pagesDir / ("page-" + to_string(page) + ".json"); };
+
+    /* Pages are independent files, one task each */
+    atomic<bool> ok{ true };
+    parallelFor(0, pages, 1, [&](size_t page, size_t) {
+        span<const uint32_t> slice(ids.data() + page * pageSize, min(pageSize, ids.size() - page * pageSize));
+        if (writeFile(pageFile(page), [&](JsonWriter& writer) { writeUsers(writer, users, slice); }, false) == false)
+           { ok = false; }
+    });
+
+    /* Pages are rewritten in place, so drop whatever an earlier, longer list or another format left behind.
+       The compressor may still be working on stale pages: deleting every stale page before any stale .gz means
+       it drops a .gz it finishes late instead of putting it back. Temp files of current pages are in flight. */
+    set<string> current;
+    for (size_t page = 0; page < pages; ++page)   { current.insert(pathFor(pageFile(page)).filename().string()); }
+    vector<filesystem::path> stalePages, staleGz;
+    for (auto& entry : filesystem::directory_iterator(pagesDir, ignored))
+    {
+        string name = entry.path().filename().string();
+        string base = name.ends_with(".tmp") ? name.substr(0, name.size() - 4) : name;
+        bool gz = base.ends_with(".gz");
+        if (gz)   { base.resize(base.size() - 3); }
+        if (current.count(base))   { continue; }
+        (gz ? staleGz : stalePages).push_back(entry.path());
+    }
+    for (auto* stale : { &stalePages, &staleGz })
+    {
+        for (auto& file : *stale)
+        {
+            filesystem::remove(file, ignored);
+            if (etags != nullptr)   { etags->forget(file); }
+        }
+    }
+
+    /* The manifest goes last, so every page it lists is already in place; writing it saves the etags of them all */
+    return write(manifest, [&](JsonWriter& writer) {
+        writer.beginObject();
+        writer.member("count", (uint64_t)ids.size());
+        writer.member("pageSize", (uint64_t)pageSize);
+        writer.key("pages");
+        writer.beginArray(pages);
+        for (size_t page = 0; page < pages; ++page)
+        {
+            size_t first = page * pageSize;
+            size_t last = min(first + pageSize, ids.size()) - 1;
+            writer.beginObject();
+            writer.member("count", (uint64_t)(last - first + 1));
+            writer.member("file", (path.stem() / pathFor(pageFile(page)).filename()).generic_string());
+            writer.member("firstUserID", users[ids[first]].userID);
+            writer.member("lastUserID", users[ids[last]].userID);
+            writer.member("offset", (uint64_t)first);
+            writer.endObject();
+        }
+        writer.endArray();
+        writer.endObject();
+    }) && ok;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "User.h"
+#include "Graph.h"
+#include "UserTable.h"
+#include "UserIndex.h"
+#include "Analytics.h"
+#include "RowBitmap.h"
+#include "JsonWriter.h"
+#include "Compression.h"
+#include "ContentHash.h"
+#include <vector>
+#include <map>
+#include <mutex>
+#include <string>
+#include <span>
+#include <functional>
+#include <filesystem>
+
+using namespace std;
+
+/* The dashboard exports, streamed through a JsonWriter one record at a time instead of being built as a
+   nlohmann::json tree first. Keys are written in alphabetical order so the output is the same as the old
+   json::dump() of the equivalent tree, and arrays announce their length so the binary formats can stream too. */
+
+/* {"age", "country", "genre", "lastLogin", "name", "subscription", "userID", "watchTime"} */
+void writeUser(JsonWriter& writer, const User& user);
+
+/* Array of users, or of the users at the given rows */
+void writeUsers(JsonWriter& writer, const vector<User>& users);
+void writeUsers(JsonWriter& writer, const vector<User>& users, const RowBitmap& rows);
+void writeUsers(JsonWriter& writer, const vector<User>& users, span<const uint32_t> rows);
+
+/* Array of {"similarity", "user1", "user1ID", "user2", "user2ID"}; the user objects are looked up by ID and
+   left out for IDs the index does not know */
+void writeSimilarities(JsonWriter& writer, const vector<UserSimilarity>& sims, const vector<User>& users,
+                       const UserTable& table, const UserIdIndex& byUserID);
+
+/* {"edges": [{"from", "to"}...], "nodes": [{"id", "label"}...]}, each undirected edge once */
+void writeGraph(JsonWriter& writer, const Graph& graph);
+
+/* [{"ageRange", "genre"}...] for the groups that have users */
+void writeGenreByAgeGroup(JsonWriter& writer, const vector<pair<string, string>>& groups);
+
+/* {"<country>": average hours...} */
+void writeAverageWatchTime(JsonWriter& writer, const map<string, double>& averages);
+
+/* {"activeWithin": [{"days", "users"}...],
+    "churnRisk": {"<plan>": {"active", "atRisk", "churned", "cooling"}...},
+    "loginMonths": {"byCountry": {"<country>": [users per month]...}, "byGenre": {...}, "months": ["YYYY-MM"...]},
+    "referenceDate", "undated"}
+   with plans, countries and genres in name order and referenceDate null when no login is dated */
+void writeRecency(JsonWriter& writer, const RecencyScan& scan, const UserTable& table);
+
+/* ---------------- Dashboard Bundle ---------------- */
+/* Layout version of the bundle; bump it whenever a reader would have to change */
+const int DASHBOARD_BUNDLE_VERSION = 1;
+
+/* Everything the dashboard fetches, in one document:
+   {"avgWatchTimeByCountry", "genreForAgeGroup", "recency", "similarUsers", "subscriptions": {"<plan>": [users]...},
+    "topActiveUsers", "userCount", "version"}
+   each part laid out like its own export file */
+void writeDashboard(JsonWriter& writer, const DashboardScan& scan, const RecencyScan& recency,
+                    const vector<UserSimilarity>& sims, const vector<User>& users, const UserTable& table,
+                    const UserIdIndex& byUserID);
+
+/* ---------------- ETag Manifest ---------------- */
+/* Sidecar file recording the content hash and size of every export:
+   {"files": {"<path relative to the sidecar>": {"etag", "size"}...}, "generation"}
+   generation goes up whenever an export changes, so a client can poll this one small file to learn whether
+   anything needs fetching again. Changes are kept in memory until flush() saves them all at once (through a
+   temp file and a rename), so a paged export rewrites the sidecar once rather than once per page; the
+   destructor flushes what is left. Safe to share between threads. */
+class ETagManifest
+{
+    private:
+
+        struct Entry
+        {
+            string etag;
+            uint64_t size;
+        };
+
+        filesystem::path path;
+        map<string, Entry> files;
+        uint64_t generation = 0;
+        bool dirty = false;             /* changed since the last save */
+        mutable mutex lock;
+
+        string keyFor(const filesystem::path& file) const;
+        bool save() const;              /* callers hold the lock */
+
+    public:
+
+        /* Loads the sidecar at 'path' if there is a readable one */
+        explicit ETagManifest(const filesystem::path& path);
+        ~ETagManifest();
+
+        ETagManifest(const ETagManifest&) = delete;
+        ETagManifest& operator=(const ETagManifest&) = delete;
+
+        /* Whether 'file' was recorded with this etag and size and is still on disk at that size */
+        bool unchanged(const filesystem::path& file, const string& etag, uint64_t size) const;
+
+        void record(const filesystem::path& file, const string& etag, uint64_t size);
+        void forget(const filesystem::path& file);
+
+        /* Save the sidecar if anything changed since the last flush; a save that fails is retried next time */
+        void flush();
+
+        uint64_t getGeneration() const;
+};
+
+/* ---------------- Export Files ---------------- */
+/* Writes export files in the chosen format, the path's extension replaced by the format's. A file is written
+   to "<name>.tmp" and renamed over the target, so readers see the old or the new version, never a partial one.
+   With a compressor set, each file also gets a gzip sibling ("x.json" -> "x.json.gz"), compressed on the
+   compressor's thread from the file once it is in place; write() never waits for it. Until the sibling is
+   finished a reader can find the new file next to the previous .gz (or none): take the .gz only once the
+   compressor is idle. An unchanged file is not compressed again.
+   With an ETag manifest set, the content is hashed while it streams, and a file whose hash and size match its
+   recorded ones is left alone: the temp file is dropped and the target keeps its timestamp. Each call below
+   flushes the manifest once when it is done, however many files it wrote or deleted. */
+struct Exporter
+{
+    ExportFormat format = ExportFormat::Json;
+    BackgroundCompressor* compressor = nullptr;
+    ETagManifest* etags = nullptr;
+    size_t pageSize = 0;                /* writeUserList: users per page, 0 for a single file */
+
+    /* The file written for 'path' in this format */
+    filesystem::path pathFor(filesystem::path path) const;
+
+    /* emit(writer) writes the document; trailingNewline ends text formats with '\n'.
+       Returns false, after telling cerr, if the file cannot be written. An exception from emit (an invalid UTF-8
+       string, say) drops the temp file and the gzip sibling, and is passed on to the caller. */
+    bool write(const filesystem::path& path, const function<void(JsonWriter&)>& emit, bool trailingNewline = false) const;
+
+    /* A list of users: one file at 'path', or with pageSize set, pages of pageSize users written in parallel
+       ("x.json" -> "x/page-0.json", "x/page-1.json", ...) followed by "x.manifest.json":
+       {"count", "pageSize", "pages": [{"count", "file", "firstUserID", "lastUserID", "offset"}...]}
+       with file paths relative to the manifest. Whichever layout is not written is deleted, so a reader
+       never finds a stale one. */
+    bool writeUserList(const filesystem::path& path, const vector<User>& users, const RowBitmap& rows) const;
+
+    /* Delete the file for 'path' in this format and its gzip sibling, if present, and their manifest entry */
+    void remove(const filesystem::path& path) const;
+
+    /* The same for every format, or with exceptThisFormat every format but this one */
+    void removeAllFormats(const filesystem::path& path, bool exceptThisFormat = false) const;
+
+    private:
+
+        /* write() without flushing the manifest */
+        bool writeFile(const filesystem::path& path, const function<void(JsonWriter&)>& emit, bool trailingNewline) const;
+        void flushETags() const;
+};
+
@@ -36,7 +36,7 @@ class Graph
 
         void printGraph() const;
 
-        unordered_map<string, vector<string>> getAdjList() const {
+        const unordered_map<string, vector<string>>& getAdjList() const {
             return adjList;
         }
 
@@ -0,0 +1,528 @@
+#include "GroupBy.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "Arena.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace std;
+
+
+/* Key spaces up to this size index a flat slot array instead of hashing */
+static const uint64_t DENSE_KEY_LIMIT = 1 << 16;
+
+/* Reads the code of a groupable column for one row */
+struct CodeReader
+{
+    const uint16_t* codes = nullptr;   /* dictionary columns */
+    const int* ages = nullptr;         /* Age and AgeBucket */
+    int width = 1;
+    uint64_t cardinality = 1;
+
+    int at(size_t row) const   { return codes ? codes[row] : max(ages[row], 0) / width; }
+};
+
+/* Reads a numeric column for one row */
+struct ValueReader
+{
+    const double* doubles = nullptr;   /* WatchTime */
+    const int* ints = nullptr;         /* Age */
+
+    double at(size_t row) const   { return doubles ? doubles[row] : ints[row]; }
+};
+
+struct AggState
+{
+    CompensatedSum sum;
+    double min = numeric_limits<double>::infinity();
+    double max = -numeric_limits<double>::infinity();
+};
+
+/* Column readers and array layout shared by every thread running the query */
+struct Plan
+{
+    vector<CodeReader> keyReaders;
+    uint64_t keySpace = 1;
+    bool dense = true;
+
+    vector<ValueReader> valueReaders;  /* per aggregate, used by Sum/Avg/Min/Max */
+    vector<CodeReader> modeReaders;    /* per aggregate, used by Mode only */
+    vector<size_t> modeOffsets;        /* per aggregate, offset of its counters within a group */
+    size_t modeWidth = 0;              /* mode counters per group */
+};
+
+/* One thread's groups, kept in that thread's arena; group g owns states[g * aggregates ...] and
+   modeCounts[g * modeWidth ...] */
+struct Partial
+{
+    pmr::vector<int32_t> denseSlots;
+    pmr::unordered_map<uint64_t, uint32_t> hashSlots;
+
+    pmr::vector<uint64_t> keys;
+    pmr::vector<uint64_t> counts;
+    pmr::vector<AggState> states;
+    pmr::vector<uint32_t> modeCounts;
+
+    explicit Partial(pmr::memory_resource* arena)
+        : denseSlots(arena), hashSlots(arena), keys(arena), counts(arena), states(arena), modeCounts(arena) {}
+};
+
+
+static CodeReader codeReader(const UserTable& table, const GroupByQuery& query, Column column)
+{
+    CodeReader reader;
+
+    switch (column)
+    {
+        case Column::Country:       reader.codes = table.countryCodes.data();       reader.cardinality = table.countries.size();     break;
+        case Column::Genre:         reader.codes = table.genreCodes.data();         reader.cardinality = table.genres.size();        break;
+        case Column::Subscription:  reader.codes = table.subscriptionCodes.data();  reader.cardinality = table.subscriptions.size(); break;
+        case Column::LoginMonth:    reader.codes = table.loginMonthCodes.data();    reader.cardinality = table.loginMonths.size();   break;
+        case Column::AgeBucket:
+        case Column::Age:
+            reader.ages = table.ages.data();
+            reader.width = column == Column::AgeBucket ? query.ageBucketWidth : 1;
+            if (reader.width <= 0)   { throw invalid_argument("Age bucket width must be positive"); }
+            reader.cardinality = max(table.maxAge, 0) / reader.width + 1;
+            break;
+        case Column::WatchTime:
+            throw invalid_argument("watchTime is continuous and cannot be grouped on or used for mode");
+    }
+
+    reader.cardinality = max<uint64_t>(reader.cardinality, 1);
+    return reader;
+}
+
+static double valueAt(const UserTable& table, Column column, int ageBucketWidth, size_t row)
+{
+    switch (column)
+    {
+        case Column::Country:       return table.countryCodes[row];
+        case Column::Genre:         return table.genreCodes[row];
+        case Column::Subscription:  return table.subscriptionCodes[row];
+        case Column::LoginMonth:    return table.loginMonthCodes[row];
+        case Column::AgeBucket:     return max(table.ages[row], 0) / ageBucketWidth;
+        case Column::Age:           return table.ages[row];
+        case Column::WatchTime:     return table.watchTimes[row];
+    }
+    return 0.0;
+}
+
+bool rowPasses(const UserTable& table, const vector<RowFilter>& where, size_t row, int ageBucketWidth)
+{
+    for (const auto& f : where)
+    {
+        double v = valueAt(table, f.column, ageBucketWidth, row);
+        if (v < f.minValue || v > f.maxValue)   { return false; }
+    }
+    return true;
+}
+
+static Plan makePlan(const UserTable& table, const GroupByQuery& query)
+{
+    Plan plan;
+
+    for (Column key : query.keys)
+    {
+        CodeReader reader = codeReader(table, query, key);
+        if (plan.keySpace > numeric_limits<uint64_t>::max() / reader.cardinality)
+        {
+            throw invalid_argument("Too many distinct key combinations to group on");
+        }
+        plan.keySpace *= reader.cardinality;
+        plan.keyReaders.push_back(reader);
+    }
+    plan.dense = plan.keySpace <= DENSE_KEY_LIMIT;
+
+    for (const auto& agg : query.aggregates)
+    {
+        bool numeric = agg.column == Column::Age || agg.column == Column::WatchTime;
+        if (agg.op != AggregateOp::Count && agg.op != AggregateOp::Mode && numeric == false)
+        {
+            throw invalid_argument(aggregateName(agg) + " needs a numeric column (age, watchTime)");
+        }
+
+        ValueReader value;
+        if (agg.column == Column::WatchTime)   { value.doubles = table.watchTimes.data(); }
+        else                                   { value.ints = table.ages.data(); }
+        plan.valueReaders.push_back(value);
+
+        CodeReader reader;
+        plan.modeOffsets.push_back(plan.modeWidth);
+        if (agg.op == AggregateOp::Mode)
+        {
+            reader = codeReader(table, query, agg.column);
+            plan.modeWidth += reader.cardinality;
+        }
+        plan.modeReaders.push_back(reader);
+    }
+
+    return plan;
+}
+
+static uint32_t addGroup(Partial& p, const Plan& plan, size_t aggregates, uint64_t key)
+{
+    uint32_t g = (uint32_t)p.keys.size();
+    p.keys.push_back(key);
+    p.counts.push_back(0);
+    p.states.resize(p.states.size() + aggregates);
+    p.modeCounts.resize(p.modeCounts.size() + plan.modeWidth, 0);
+    return g;
+}
+
+static uint32_t groupSlot(Partial& p, const Plan& plan, size_t aggregates, uint64_t key)
+{
+    if (plan.dense)
+    {
+        if (p.denseSlots[key] < 0)   { p.denseSlots[key] = addGroup(p, plan, aggregates, key); }
+        return p.denseSlots[key];
+    }
+
+    auto it = p.hashSlots.find(key);
+    if (it != p.hashSlots.end())   { return it->second; }
+
+    uint32_t g = addGroup(p, plan, aggregates, key);
+    p.hashSlots.emplace(key, g);
+    return g;
+}
+
+/* Rows are processed a block at a time: first every row's group slot, then one tight loop per aggregate,
+   so the aggregate dispatch happens once per block instead of once per row */
+static const size_t BLOCK_ROWS = 1024;
+
+static void aggregateRows(const UserTable& table, const GroupByQuery& query, const Plan& plan,
+                          size_t begin, size_t end, Partial& p)
+{
+    size_t aggregates = query.aggregates.size();
+    if (plan.dense)   { p.denseSlots.assign(plan.keySpace, -1); }
+
+    uint32_t rows[BLOCK_ROWS];
+    uint64_t keys[BLOCK_ROWS];
+    uint32_t groups[BLOCK_ROWS];
+
+    for (size_t blockStart = begin; blockStart < end; blockStart += BLOCK_ROWS)
+    {
+        size_t blockEnd = min(end, blockStart + BLOCK_ROWS);
+        size_t m = 0;
+
+        /* Rows of the block that pass the filters */
+        for (size_t row = blockStart; row < blockEnd; ++row)
+        {
+            if (query.where.empty() == false
+                && rowPasses(table, query.where, row, query.ageBucketWidth) == false)   { continue; }
+            rows[m++] = (uint32_t)row;
+        }
+
+        /* Mixed radix: key = c0 + card0 * (c1 + card1 * (c2 + ...)), built one key column at a time */
+        fill(keys, keys + m, 0);
+        for (size_t k = plan.keyReaders.size(); k-- > 0; )
+        {
+            const CodeReader& reader = plan.keyReaders[k];
+            if (reader.codes)
+            {
+                for (size_t j = 0; j < m; ++j)   { keys[j] = keys[j] * reader.cardinality + reader.codes[rows[j]]; }
+            }
+            else
+            {
+                for (size_t j = 0; j < m; ++j)   { keys[j] = keys[j] * reader.cardinality + reader.at(rows[j]); }
+            }
+        }
+
+        if (plan.dense)
+        {
+            int32_t* slots = p.denseSlots.data();
+            for (size_t j = 0; j < m; ++j)
+            {
+                if (slots[keys[j]] < 0)   { slots[keys[j]] = addGroup(p, plan, aggregates, keys[j]); }
+                groups[j] = slots[keys[j]];
+            }
+        }
+        else
+        {
+            for (size_t j = 0; j < m; ++j)   { groups[j] = groupSlot(p, plan, aggregates, keys[j]); }
+        }
+
+        uint64_t* counts = p.counts.data();
+        for (size_t j = 0; j < m; ++j)   { ++counts[groups[j]]; }
+
+        for (size_t a = 0; a < aggregates; ++a)
+        {
+            AggState* states = p.states.data() + a;
+            const ValueReader& value = plan.valueReaders[a];
+
+            switch (query.aggregates[a].op)
+            {
+                case AggregateOp::Count:
+                    break;
+                case AggregateOp::Sum:
+                case AggregateOp::Avg:
+                    if (value.doubles)
+                    {
+                        for (size_t j = 0; j < m; ++j)   { states[groups[j] * aggregates].sum.add(value.doubles[rows[j]]); }
+                    }
+                    else
+                    {
+                        for (size_t j = 0; j < m; ++j)   { states[groups[j] * aggregates].sum.add(value.ints[rows[j]]); }
+                    }
+                    break;
+                case AggregateOp::Min:
+                    for (size_t j = 0; j < m; ++j)
+                    {
+                        AggState& state = states[groups[j] * aggregates];
+                        state.min = min(state.min, value.at(rows[j]));
+                    }
+                    break;
+                case AggregateOp::Max:
+                    for (size_t j = 0; j < m; ++j)
+                    {
+                        AggState& state = states[groups[j] * aggregates];
+                        state.max = max(state.max, value.at(rows[j]));
+                    }
+                    break;
+                case AggregateOp::Mode:
+                {
+                    uint32_t* counts = p.modeCounts.data() + plan.modeOffsets[a];
+                    const CodeReader& code = plan.modeReaders[a];
+                    for (size_t j = 0; j < m; ++j)   { ++counts[groups[j] * plan.modeWidth + code.at(rows[j])]; }
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/* Fold the groups of 'src' into 'dst' */
+static void mergePartial(Partial& dst, const Partial& src, const Plan& plan, size_t aggregates)
+{
+    for (size_t g = 0; g < src.keys.size(); ++g)
+    {
+        uint32_t d = groupSlot(dst, plan, aggregates, src.keys[g]);
+        dst.counts[d] += src.counts[g];
+
+        for (size_t a = 0; a < aggregates; ++a)
+        {
+            AggState& to = dst.states[(size_t)d * aggregates + a];
+            const AggState& from = src.states[g * aggregates + a];
+            to.sum.add(from.sum.sum);
+            to.sum.add(from.sum.compensation);
+            to.min = min(to.min, from.min);
+            to.max = max(to.max, from.max);
+        }
+
+        for (size_t m = 0; m < plan.modeWidth; ++m)
+        {
+            dst.modeCounts[(size_t)d * plan.modeWidth + m] += src.modeCounts[g * plan.modeWidth + m];
+        }
+    }
+}
+
+/* Label order: alphabetical for dictionary columns, numeric for ages */
+static bool labelLess(const UserTable& table, Column column, int a, int b)
+{
+    switch (column)
+    {
+        case Column::Country:       return table.countries.decode(a) < table.countries.decode(b);
+        case Column::Genre:         return table.genres.decode(a) < table.genres.decode(b);
+        case Column::Subscription:  return table.subscriptions.decode(a) < table.subscriptions.decode(b);
+        case Column::LoginMonth:    return table.loginMonths.decode(a) < table.loginMonths.decode(b);
+        default:                    return a < b;
+    }
+}
+
+
+GroupByResult groupBy(const UserTable& table, const GroupByQuery& query, unsigned int threadCount)
+{
+    TraceSpan span("groupBy");
+    Plan plan = makePlan(table, query);
+    size_t n = table.size();
+    size_t aggregates = query.aggregates.size();
+
+    threadCount = scanThreadCount(n, threadCount);
+    size_t chunk = (n + threadCount - 1) / threadCount;
+
+    /* Everything but the result is scratch: each slice's groups and slot maps go to its own arena, dropped
+       in one go when the query returns */
+    auto arenas = make_unique<ScratchArena<>[]>(threadCount);
+    vector<Partial> partials;
+    partials.reserve(threadCount);
+    for (unsigned int t = 0; t < threadCount; ++t)   { partials.emplace_back(&arenas[t]); }
+
+    auto runSlice = [&](unsigned int t)
+    {
+        TraceSpan slice("groupBy.slice");
+        size_t begin = min(n, t * chunk);
+        aggregateRows(table, query, plan, begin, min(n, begin + chunk), partials[t]);
+    };
+
+    parallelFor(0, threadCount, 1, [&](size_t lo, size_t) { runSlice((unsigned int)lo); });
+
+    Partial& total = partials[0];
+    for (unsigned int t = 1; t < threadCount; ++t)   { mergePartial(total, partials[t], plan, aggregates); }
+
+    GroupByResult result;
+    result.query = query;
+    result.rows.reserve(total.keys.size());
+
+    for (size_t g = 0; g < total.keys.size(); ++g)
+    {
+        GroupRow row;
+        row.count = total.counts[g];
+
+        uint64_t key = total.keys[g];
+        for (const auto& reader : plan.keyReaders)
+        {
+            row.keys.push_back((int)(key % reader.cardinality));
+            key /= reader.cardinality;
+        }
+
+        for (size_t a = 0; a < aggregates; ++a)
+        {
+            const Aggregate& agg = query.aggregates[a];
+            const AggState& state = total.states[g * aggregates + a];
+            switch (agg.op)
+            {
+                case AggregateOp::Count:  row.values.push_back((double)row.count);             break;
+                case AggregateOp::Sum:    row.values.push_back(state.sum.value());             break;
+                case AggregateOp::Avg:    row.values.push_back(state.sum.value() / row.count); break;
+                case AggregateOp::Min:    row.values.push_back(state.min);                     break;
+                case AggregateOp::Max:    row.values.push_back(state.max);                     break;
+                case AggregateOp::Mode:
+                {
+                    /* Most frequent code; ties go to the first label in label order */
+                    const uint32_t* counts = &total.modeCounts[g * plan.modeWidth + plan.modeOffsets[a]];
+                    int best = -1;
+                    for (int c = 0; c < (int)plan.modeReaders[a].cardinality; ++c)
+                    {
+                        if (counts[c] == 0)   { continue; }
+                        if (best < 0 || counts[c] > counts[best]
+                            || (counts[c] == counts[best] && labelLess(table, agg.column, c, best)))
+                        {
+                            best = c;
+                        }
+                    }
+                    row.values.push_back(best);
+                    break;
+                }
+            }
+        }
+
+        result.rows.push_back(move(row));
+    }
+
+    sort(result.rows.begin(), result.rows.end(),
+         [&](const GroupRow& a, const GroupRow& b) {
+             for (size_t k = 0; k < query.keys.size(); ++k)
+             {
+                 if (a.keys[k] == b.keys[k])   { continue; }
+                 return labelLess(table, query.keys[k], a.keys[k], b.keys[k]);
+             }
+             return false;
+         });
+
+    return result;
+}
+
+vector<uint32_t> selectRows(const UserTable& table, const vector<RowFilter>& where, int ageBucketWidth)
+{
+    vector<uint32_t> rows;
+    for (size_t row = 0; row < table.size(); ++row)
+    {
+        if (rowPasses(table, where, row, ageBucketWidth))   { rows.push_back((uint32_t)row); }
+    }
+    return rows;
+}
+
+string columnLabel(const UserTable& table, const GroupByQuery& query, Column column, int code)
+{
+    switch (column)
+    {
+        case Column::Country:       return table.countries.decode(code);
+        case Column::Genre:         return table.genres.decode(code);
+        case Column::Subscription:  return table.subscriptions.decode(code);
+        case Column::LoginMonth:    return table.loginMonths.decode(code);
+        case Column::AgeBucket:
+        {
+            int lo = code * query.ageBucketWidth;
+            return to_string(lo) + "-" + to_string(lo + query.ageBucketWidth - 1);
+        }
+        case Column::Age:           return to_string(code);
+        case Column::WatchTime:     break;
+    }
+    throw invalid_argument("watchTime values have no label");
+}
+
+
+/* ---------------- Column / aggregate names ---------------- */
+
+static string lowercase(string s)
+{
+    for (char& c : s)   { c = (char)tolower((unsigned char)c); }
+    return s;
+}
+
+Column parseColumn(const string& name)
+{
+    string n = lowercase(name);
+
+    if (n == "country")                        { return Column::Country; }
+    if (n == "genre")                          { return Column::Genre; }
+    if (n == "subscription")                   { return Column::Subscription; }
+    if (n == "month" || n == "loginmonth")     { return Column::LoginMonth; }
+    if (n == "agebucket")                      { return Column::AgeBucket; }
+    if (n == "age")                            { return Column::Age; }
+    if (n == "watchtime")                      { return Column::WatchTime; }
+
+    throw invalid_argument("Unknown column: " + name);
+}
+
+Aggregate parseAggregate(const string& spec)
+{
+    size_t colon = spec.find(':');
+    string op = lowercase(spec.substr(0, colon));
+
+    Aggregate agg;
+    if      (op == "count")  { agg.op = AggregateOp::Count; }
+    else if (op == "sum")    { agg.op = AggregateOp::Sum; }
+    else if (op == "avg")    { agg.op = AggregateOp::Avg; }
+    else if (op == "min")    { agg.op = AggregateOp::Min; }
+    else if (op == "max")    { agg.op = AggregateOp::Max; }
+    else if (op == "mode")   { agg.op = AggregateOp::Mode; }
+    else                     { throw invalid_argument("Unknown aggregate: " + spec); }
+
+    if (colon != string::npos)   { agg.column = parseColumn(spec.substr(colon + 1)); }
+    return agg;
+}
+
+string columnName(Column column)
+{
+    switch (column)
+    {
+        case Column::Country:       return "country";
+        case Column::Genre:         return "genre";
+        case Column::Subscription:  return "subscription";
+        case Column::LoginMonth:    return "month";
+        case Column::AgeBucket:     return "ageBucket";
+        case Column::Age:           return "age";
+        case Column::WatchTime:     return "watchTime";
+    }
+    return "";
+}
+
+string aggregateName(const Aggregate& aggregate)
+{
+    switch (aggregate.op)
+    {
+        case AggregateOp::Count:  return "count";
+        case AggregateOp::Sum:    return "sum(" + columnName(aggregate.column) + ")";
+        case AggregateOp::Avg:    return "avg(" + columnName(aggregate.column) + ")";
+        case AggregateOp::Min:    return "min(" + columnName(aggregate.column) + ")";
+        case AggregateOp::Max:    return "max(" + columnName(aggregate.column) + ")";
+        case AggregateOp::Mode:   return "mode(" + columnName(aggregate.column) + ")";
+    }
+    return "";
+}
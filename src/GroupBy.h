@@ -0,0 +1,95 @@
+#pragma once
+
+#include "UserTable.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+using namespace std;
+
+/* Group-by / aggregate engine over a UserTable.
+   Each row's key columns are packed into one integer (mixed radix over the column cardinalities) and hashed,
+   or used as a direct array index when the key space is small. Threads aggregate their own slice of the rows
+   into private partials which are merged at the end. */
+
+/* Neumaier-compensated running sum: 'compensation' collects the low-order bits each addition rounds away,
+   so long sums of watch times don't drift with the row count or the order partials are merged in */
+struct CompensatedSum
+{
+    double sum = 0.0;
+    double compensation = 0.0;
+
+    void add(double v)
+    {
+        double t = sum + v;
+        if (fabs(sum) >= fabs(v))   { compensation += (sum - t) + v; }
+        else                        { compensation += (v - t) + sum; }
+        sum = t;
+    }
+
+    double value() const   { return sum + compensation; }
+};
+
+/* Columns a query can group by, filter on or aggregate */
+enum class Column { Country, Genre, Subscription, LoginMonth, AgeBucket, Age, WatchTime };
+
+enum class AggregateOp { Count, Sum, Avg, Min, Max, Mode };
+
+struct Aggregate
+{
+    AggregateOp op;
+    Column column = Column::WatchTime;     /* Sum/Avg/Min/Max need Age or WatchTime; Mode needs anything but WatchTime; Count ignores it */
+};
+
+/* Keeps rows whose value lies in [minValue, maxValue]; dictionary columns compare codes */
+struct RowFilter
+{
+    Column column;
+    double minValue;
+    double maxValue;
+
+    static RowFilter equals(Column column, double value)             { return { column, value, value }; }
+    static RowFilter between(Column column, double lo, double hi)    { return { column, lo, hi }; }
+};
+
+struct GroupByQuery
+{
+    vector<Column> keys;               /* any column but WatchTime; no keys puts every row in one group */
+    vector<Aggregate> aggregates;
+    vector<RowFilter> where;
+    int ageBucketWidth = 5;            /* AgeBucket b holds ages b*width .. b*width + width-1 */
+};
+
+struct GroupRow
+{
+    vector<int> keys;                  /* one code per key column */
+    uint64_t count = 0;                /* rows in the group */
+    vector<double> values;             /* one per aggregate; Mode yields the code of the most frequent value */
+};
+
+struct GroupByResult
+{
+    GroupByQuery query;
+    vector<GroupRow> rows;             /* sorted by key label, first key column first */
+};
+
+/* Run the query over threadCount slices of the rows (0: one per hardware thread), each a task on the shared
+   ThreadPool. Throws invalid_argument for unsupported column uses. */
+GroupByResult groupBy(const UserTable& table, const GroupByQuery& query, unsigned int threadCount = 0);
+
+/* Whether one row passes every filter */
+bool rowPasses(const UserTable& table, const vector<RowFilter>& where, size_t row, int ageBucketWidth = 5);
+
+/* Ids of the rows passing every filter, ascending */
+vector<uint32_t> selectRows(const UserTable& table, const vector<RowFilter>& where, int ageBucketWidth = 5);
+
+/* Printable form of a key code or Mode result of the given column */
+string columnLabel(const UserTable& table, const GroupByQuery& query, Column column, int code);
+
+/* Names used by the menu: country, genre, subscription, month, ageBucket, age, watchTime / count, sum, avg, min, max, mode.
+   The parsers throw invalid_argument on unknown names; parseAggregate reads "op" or "op:column". */
+Column parseColumn(const string& name);
+Aggregate parseAggregate(const string& spec);
+string columnName(Column column);
+string aggregateName(const Aggregate& aggregate);
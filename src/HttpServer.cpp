@@ -0,0 +1,466 @@
+#include "HttpServer.h"
+#include "Trace.h"
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const size_t MAX_HEADER_BYTES = 16 * 1024;
+static const size_t MAX_BODY_BYTES = 1024 * 1024;
+static const int IDLE_TIMEOUT_MS = 5000;           /* keep-alive connections idle this long are closed */
+static const int POLL_INTERVAL_MS = 200;           /* how often blocked threads look at the stop flag */
+
+
+/* ---------------- Requests and Responses ---------------- */
+
+string HttpRequest::param(const string& name, const string& fallback) const
+{
+    auto it = query.find(name);
+    return it == query.end() ? fallback : it->second;
+}
+
+HttpResponse HttpResponse::json(const function<void(JsonWriter&)>& emit, int status)
+{
+    ostringstream out;
+    {
+        JsonWriter writer(out, ExportFormat::CompactJson);
+        emit(writer);
+    }
+    return { status, "application/json", move(out).str() };
+}
+
+HttpResponse HttpResponse::error(int status, const string& message)
+{
+    return json([&](JsonWriter& writer) {
+        writer.beginObject();
+        writer.member("error", message);
+        writer.endObject();
+    }, status);
+}
+
+static const char* reasonPhrase(int status)
+{
+    switch (status)
+    {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        default:  return "Unknown";
+    }
+}
+
+/* %XX escapes and '+' for space */
+static string urlDecode(const string& s)
+{
+    string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i)
+    {
+        if (s[i] == '+')   { out += ' '; }
+        else if (s[i] == '%' && i + 2 < s.size() && isxdigit((unsigned char)s[i + 1]) && isxdigit((unsigned char)s[i + 2]))
+        {
+            out += (char)stoi(s.substr(i + 1, 2), nullptr, 16);
+            i += 2;
+        }
+        else   { out += s[i]; }
+    }
+    return out;
+}
+
+/* Parse the request line and headers; false if they are malformed */
+static bool parseHead(const string& head, HttpRequest& request, string& version)
+{
+    istringstream in(head);
+    string line;
+    if (!getline(in, line))   { return false; }
+    if (!line.empty() && line.back() == '\r')   { line.pop_back(); }
+
+    istringstream requestLine(line);
+    string target;
+    if (!(requestLine >> request.method >> target >> version))   { return false; }
+    if (version.rfind("HTTP/1.", 0) != 0 || target.empty() || target[0] != '/')   { return false; }
+
+    size_t question = target.find('?');
+    request.path = urlDecode(target.substr(0, question));
+    if (question != string::npos)
+    {
+        stringstream query(target.substr(question + 1));
+        string pair;
+        while (getline(query, pair, '&'))
+        {
+            if (pair.empty())   { continue; }
+            size_t eq = pair.find('=');
+            request.query[urlDecode(pair.substr(0, eq))] = eq == string::npos ? "" : urlDecode(pair.substr(eq + 1));
+        }
+    }
+
+    while (getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')   { line.pop_back(); }
+        if (line.empty())   { break; }
+        size_t colon = line.find(':');
+        if (colon == string::npos)   { return false; }
+
+        string name = line.substr(0, colon);
+        transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)tolower(c); });
+        size_t start = line.find_first_not_of(" \t", colon + 1);
+        request.headers[name] = start == string::npos ? "" : line.substr(start);
+    }
+    return true;
+}
+
+
+/* ---------------- Latency Histogram ---------------- */
+
+int LatencyHistogram::bucketOf(uint64_t us)
+{
+    if (us < SUB_BUCKETS)   { return (int)us; }
+
+    /* Octave o >= 3 covers [2^o, 2^(o+1)); its top three bits below the leading one pick the sub-bucket */
+    int octave = bit_width(us) - 1;
+    int sub = (int)((us >> (octave - 3)) & (SUB_BUCKETS - 1));
+    return min((octave - 2) * SUB_BUCKETS + sub, BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::upperBound(int bucket)
+{
+    if (bucket < SUB_BUCKETS)   { return bucket; }
+
+    int octave = bucket / SUB_BUCKETS + 2;
+    int sub = bucket % SUB_BUCKETS;
+    return ((uint64_t)(SUB_BUCKETS + sub + 1) << (octave - 3)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t us)
+{
+    counts[bucketOf(us)].fetch_add(1, memory_order_relaxed);
+    total.fetch_add(1, memory_order_relaxed);
+
+    uint64_t seen = maxSeen.load(memory_order_relaxed);
+    while (us > seen && maxSeen.compare_exchange_weak(seen, us, memory_order_relaxed)) {}
+}
+
+uint64_t LatencyHistogram::percentile(double p) const
+{
+    uint64_t n = total.load(memory_order_relaxed);
+    if (n == 0)   { return 0; }
+
+    uint64_t rank = max<uint64_t>(1, (uint64_t)ceil(p * n));
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; ++b)
+    {
+        seen += counts[b].load(memory_order_relaxed);
+        if (seen >= rank)   { return min(upperBound(b), maxSeen.load(memory_order_relaxed)); }
+    }
+    return maxSeen;
+}
+
+
+/* ---------------- Server ---------------- */
+
+HttpServer::HttpServer(unsigned int threadCount)
+    : threadCount(threadCount != 0 ? threadCount : max(4u, thread::hardware_concurrency())) {}
+
+void HttpServer::route(const string& path, Handler handler)
+{
+    routes[path] = { move(handler), make_unique<LatencyHistogram>() };
+}
+
+HttpResponse HttpServer::dispatch(const HttpRequest& request)
+{
+    TraceSpan span("http.request");
+    if (request.method != "GET" && request.method != "HEAD")   { return HttpResponse::error(405, "Only GET is supported"); }
+
+    if (request.path == "/stats")
+    {
+        return HttpResponse::json([this](JsonWriter& writer) { writeStats(writer); });
+    }
+
+    auto it = routes.find(request.path);
+    if (it == routes.end())   { return HttpResponse::error(404, "No endpoint " + request.path); }
+
+    try
+    {
+        return it->second.handler(request);
+    }
+    catch (const invalid_argument& e)
+    {
+        return HttpResponse::error(400, e.what());
+    }
+    catch (const exception& e)
+    {
+        return HttpResponse::error(500, e.what());
+    }
+}
+
+void HttpServer::writeStats(JsonWriter& writer) const
+{
+    writer.beginObject();
+    writer.member("connections", connections.load());
+    writer.key("endpoints");
+    writer.beginObject();
+    for (const auto& [path, route] : routes)
+    {
+        const LatencyHistogram& latency = *route.latency;
+        writer.key(path);
+        writer.beginObject();
+        writer.member("count", latency.getCount());
+        writer.member("maxUs", latency.getMax());
+        writer.member("p50Us", latency.percentile(0.50));
+        writer.member("p90Us", latency.percentile(0.90));
+        writer.member("p99Us", latency.percentile(0.99));
+        writer.endObject();
+    }
+    writer.endObject();
+    writer.member("requests", requests.load());
+    writer.endObject();
+}
+
+
+#ifdef _WIN32
+
+HttpServer::~HttpServer() {}
+
+void HttpServer::listen(const string&, uint16_t)
+{
+    throw runtime_error("The HTTP server needs POSIX sockets and is not available on Windows");
+}
+
+void HttpServer::run() {}
+void HttpServer::work() {}
+void HttpServer::serveConnection(int) {}
+
+#else
+
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;        /* a client hanging up must not raise SIGPIPE */
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+static bool sendAll(int fd, const char* data, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t sent = send(fd, data, n, SEND_FLAGS);
+        if (sent <= 0)   { return false; }
+        data += sent;
+        n -= (size_t)sent;
+    }
+    return true;
+}
+
+HttpServer::~HttpServer()
+{
+    if (listener >= 0)   { close(listener); }
+    for (int fd : waiting)   { close(fd); }
+}
+
+void HttpServer::listen(const string& host, uint16_t port)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    addrinfo* found = nullptr;
+    string service = to_string(port);
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &found) != 0 || found == nullptr)
+       { throw runtime_error("Cannot resolve " + host); }
+
+    for (addrinfo* a = found; a != nullptr && listener < 0; a = a->ai_next)
+    {
+        int fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0)   { continue; }
+
+        int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        if (::bind(fd, a->ai_addr, a->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0)   { listener = fd; }
+        else   { close(fd); }
+    }
+    freeaddrinfo(found);
+
+    if (listener < 0)   { throw runtime_error("Cannot listen on " + host + ":" + service); }
+
+    sockaddr_storage bound{};
+    socklen_t length = sizeof(bound);
+    getsockname(listener, (sockaddr*)&bound, &length);
+    boundPort = ntohs(bound.ss_family == AF_INET6 ? ((sockaddr_in6*)&bound)->sin6_port : ((sockaddr_in*)&bound)->sin_port);
+}
+
+void HttpServer::run()
+{
+    if (listener < 0)   { throw logic_error("listen() before run()"); }
+
+    vector<thread> workers;
+    for (unsigned int t = 0; t < threadCount; ++t)   { workers.emplace_back(&HttpServer::work, this); }
+
+    while (stopping == false)
+    {
+        pollfd p{ listener, POLLIN, 0 };
+        if (poll(&p, 1, POLL_INTERVAL_MS) <= 0)   { continue; }
+
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0)   { continue; }
+
+        int yes = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        ++connections;
+        {
+            lock_guard<mutex> guard(lock);
+            waiting.push_back(client);
+        }
+        wake.notify_one();
+    }
+
+    /* stop() only sets the flag, so set it again under the lock: a worker between its check of 'stopping' and
+       its wait() holds the lock, and would otherwise miss this wakeup and never return */
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers)   { worker.join(); }
+}
+
+void HttpServer::work()
+{
+    Trace::setThreadName("http worker");
+
+    while (true)
+    {
+        int client;
+        {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [this]() { return waiting.empty() == false || stopping; });
+            if (stopping)   { return; }
+            client = waiting.front();
+            waiting.pop_front();
+        }
+        serveConnection(client);
+        close(client);
+    }
+}
+
+void HttpServer::serveConnection(int client)
+{
+    string buffer;                      /* bytes read but not yet consumed; may hold the next pipelined request */
+    char chunk[16 * 1024];
+
+    /* Wait for more bytes and add them to the buffer; false once the client is gone or has been idle too long,
+       or the server is stopping, so a slow client cannot hold up shutdown */
+    auto receive = [&]() {
+        int idleMs = 0;
+        while (stopping == false)
+        {
+            pollfd p{ client, POLLIN, 0 };
+            int ready = poll(&p, 1, POLL_INTERVAL_MS);
+            if (ready < 0)   { return false; }
+            if (ready == 0)
+            {
+                idleMs += POLL_INTERVAL_MS;
+                if (idleMs >= IDLE_TIMEOUT_MS)   { return false; }
+                continue;
+            }
+
+            ssize_t got = recv(client, chunk, sizeof(chunk), 0);
+            if (got <= 0)   { return false; }
+            buffer.append(chunk, (size_t)got);
+            return true;
+        }
+        return false;
+    };
+
+    while (stopping == false)
+    {
+        /* Read until the blank line ending the headers */
+        size_t headEnd = buffer.find("\r\n\r\n");
+        if (headEnd == string::npos)
+        {
+            if (buffer.size() > MAX_HEADER_BYTES)
+            {
+                string response = "HTTP/1.1 431 Request Header Fields Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+                sendAll(client, response.data(), response.size());
+                return;
+            }
+
+            if (receive() == false)   { return; }
+            continue;
+        }
+
+        auto start = chrono::steady_clock::now();
+
+        HttpRequest request;
+        string version;
+        bool wellFormed = parseHead(buffer.substr(0, headEnd + 2), request, version);
+        buffer.erase(0, headEnd + 4);
+
+        /* Bodies are read and ignored, so the next request on the connection starts in the right place */
+        size_t bodyBytes = 0;
+        if (wellFormed && request.headers.count("content-length"))
+        {
+            try   { bodyBytes = stoul(request.headers["content-length"]); }
+            catch (const logic_error&)   { wellFormed = false; }
+        }
+        if (bodyBytes > MAX_BODY_BYTES)   { wellFormed = false; }
+        while (wellFormed && buffer.size() < bodyBytes)
+        {
+            if (receive() == false)   { return; }
+        }
+        if (wellFormed)   { buffer.erase(0, bodyBytes); }
+
+        /* HTTP/1.1 stays open unless told otherwise, HTTP/1.0 only when asked */
+        string connection = request.headers.count("connection") ? request.headers["connection"] : "";
+        transform(connection.begin(), connection.end(), connection.begin(), [](unsigned char c) { return (char)tolower(c); });
+        bool keepAlive = wellFormed
+                         && (version == "HTTP/1.0" ? connection == "keep-alive" : connection != "close");
+        if (keepAlive)
+        {
+            /* Give the worker to a waiting connection rather than to this one's next request */
+            lock_guard<mutex> guard(lock);
+            keepAlive = waiting.empty();
+        }
+
+        HttpResponse response = wellFormed ? dispatch(request) : HttpResponse::error(400, "Malformed request");
+        ++requests;
+
+        string head = "HTTP/1.1 " + to_string(response.status) + " " + reasonPhrase(response.status) + "\r\n"
+                      + "Content-Type: " + response.contentType + "\r\n"
+                      + "Content-Length: " + to_string(response.body.size()) + "\r\n"
+                      + "Access-Control-Allow-Origin: *\r\n"
+                      + "Connection: " + (keepAlive ? "keep-alive" : "close") + "\r\n\r\n";
+        bool sent = sendAll(client, head.data(), head.size())
+                    && (request.method == "HEAD" || sendAll(client, response.body.data(), response.body.size()));
+
+        auto it = routes.find(request.path);
+        if (it != routes.end())
+        {
+            auto us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+            it->second.latency->record((uint64_t)us);
+        }
+
+        if (sent == false || keepAlive == false)   { return; }
+    }
+}
+
+#endif
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "JsonWriter.h"
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+using namespace std;
+
+/* A small HTTP/1.1 server for serving analyses to the dashboard on the local machine. GET and HEAD only,
+   keep-alive, one request at a time per connection. Built on POSIX sockets; on Windows listen() throws. */
+
+struct HttpRequest
+{
+    string method;
+    string path;                        /* without the query string */
+    map<string, string> query;          /* decoded ?name=value pairs */
+    map<string, string> headers;        /* names lowercased */
+
+    /* The query parameter, or 'fallback' when it is absent */
+    string param(const string& name, const string& fallback = "") const;
+};
+
+struct HttpResponse
+{
+    int status = 200;
+    string contentType = "application/json";
+    string body;
+
+    /* A compact JSON body written by emit(writer) */
+    static HttpResponse json(const function<void(JsonWriter&)>& emit, int status = 200);
+
+    /* {"error": message} */
+    static HttpResponse error(int status, const string& message);
+};
+
+/* ---------------- Latency Histogram ---------------- */
+/* Counts of latencies in microseconds, in buckets 1/8 of a power of two wide, so a percentile is read to
+   within 12.5% from a fixed few hundred counters. Recording is lock-free and safe from any thread. */
+class LatencyHistogram
+{
+    private:
+
+        static const int SUB_BUCKETS = 8;                       /* per power of two */
+        static const int BUCKETS = 60 * SUB_BUCKETS;
+
+        atomic<uint64_t> counts[BUCKETS] = {};
+        atomic<uint64_t> total{ 0 };
+        atomic<uint64_t> maxSeen{ 0 };
+
+        static int bucketOf(uint64_t us);
+        static uint64_t upperBound(int bucket);
+
+    public:
+
+        void record(uint64_t us);
+
+        uint64_t getCount() const   { return total; }
+        uint64_t getMax() const     { return maxSeen; }
+
+        /* Smallest bucket bound at or above fraction p (0..1) of the recorded latencies, 0 when empty */
+        uint64_t percentile(double p) const;
+};
+
+/* ---------------- Server ---------------- */
+/* One thread accepts connections and queues them; a fixed pool of workers serves them. A worker keeps a
+   connection while the client keeps it alive, but closes it after the current response when other connections
+   are waiting, so idle keep-alive clients cannot hold every worker. Handlers run concurrently. */
+class HttpServer
+{
+    public:
+
+        using Handler = function<HttpResponse(const HttpRequest&)>;
+
+    private:
+
+        struct Route
+        {
+            Handler handler;
+            unique_ptr<LatencyHistogram> latency;
+        };
+
+        map<string, Route> routes;
+        int listener = -1;
+        uint16_t boundPort = 0;
+        unsigned int threadCount;
+
+        deque<int> waiting;             /* accepted connections no worker has taken yet */
+        mutex lock;
+        condition_variable wake;
+        atomic<bool> stopping{ false };
+        atomic<uint64_t> connections{ 0 };
+        atomic<uint64_t> requests{ 0 };
+
+        void serveConnection(int client);
+        void work();
+        HttpResponse dispatch(const HttpRequest& request);
+
+    public:
+
+        /* threadCount 0 uses every hardware thread (at least 4) */
+        explicit HttpServer(unsigned int threadCount = 0);
+        ~HttpServer();
+
+        HttpServer(const HttpServer&) = delete;
+        HttpServer& operator=(const HttpServer&) = delete;
+
+        /* Serve GET 'path' with 'handler'; register every route before run().
+           A handler's invalid_argument becomes 400 with its message, any other exception 500. */
+        void route(const string& path, Handler handler);
+
+        /* Bind to host:port (port 0 picks a free one); throws runtime_error when that fails */
+        void listen(const string& host, uint16_t port);
+        uint16_t getPort() const   { return boundPort; }
+
+        /* Serve until stop(); also serves GET /stats with the numbers of writeStats */
+        void run();
+
+        /* Ask run() to return; only stores a flag, so a signal handler may call it */
+        void stop()   { stopping = true; }
+
+        /* {"connections", "endpoints": {"<path>": {"count", "maxUs", "p50Us", "p90Us", "p99Us"}...}, "requests"} */
+        void writeStats(JsonWriter& writer) const;
+};
@@ -0,0 +1,363 @@
+#include "JsonWriter.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+
+/* ---------------- Formats ---------------- */
+
+ExportFormat parseExportFormat(const string& name)
+{
+    if (name == "json")      { return ExportFormat::Json; }
+    if (name == "compact")   { return ExportFormat::CompactJson; }
+    if (name == "ndjson")    { return ExportFormat::NDJson; }
+    if (name == "cbor")      { return ExportFormat::Cbor; }
+    if (name == "msgpack")   { return ExportFormat::MessagePack; }
+    throw invalid_argument("Unknown export format: " + name);
+}
+
+string exportFormatName(ExportFormat format)
+{
+    switch (format)
+    {
+        case ExportFormat::Json:          return "json";
+        case ExportFormat::CompactJson:   return "compact";
+        case ExportFormat::NDJson:        return "ndjson";
+        case ExportFormat::Cbor:          return "cbor";
+        case ExportFormat::MessagePack:   return "msgpack";
+    }
+    return "";
+}
+
+string exportFormatExtension(ExportFormat format)
+{
+    switch (format)
+    {
+        case ExportFormat::Json:
+        case ExportFormat::CompactJson:   return ".json";
+        case ExportFormat::NDJson:        return ".ndjson";
+        case ExportFormat::Cbor:          return ".cbor";
+        case ExportFormat::MessagePack:   return ".msgpack";
+    }
+    return "";
+}
+
+bool isBinaryFormat(ExportFormat format)
+{
+    return format == ExportFormat::Cbor || format == ExportFormat::MessagePack;
+}
+
+
+/* ---------------- Buffer ---------------- */
+
+JsonWriter::JsonWriter(ostream& out, ExportFormat format)
+    : out(out), format(format), indent(format == ExportFormat::Json ? 2 : -1) {}
+
+JsonWriter::~JsonWriter()   { flush(); }
+
+void JsonWriter::flush()
+{
+    if (used > 0)   { out.write(buffer, (streamsize)used); }
+    used = 0;
+}
+
+void JsonWriter::put(const char* s, size_t n)
+{
+    if (n > BUFFER_SIZE - used)
+    {
+        flush();
+        if (n > BUFFER_SIZE)
+        {
+            out.write(s, (streamsize)n);
+            return;
+        }
+    }
+    memcpy(buffer + used, s, n);
+    used += n;
+}
+
+void JsonWriter::newline(size_t depth)
+{
+    put('\n');
+    for (size_t i = 0; i < depth * (size_t)indent; ++i)   { put(' '); }
+}
+
+
+/* ---------------- Structure ---------------- */
+
+void JsonWriter::beforeValue()
+{
+    if (afterKey)
+    {
+        afterKey = false;
+        return;
+    }
+    if (levels.empty() || isBinaryFormat(format))   { return; }
+
+    Level& level = levels.back();
+    bool first = level.empty;
+    level.empty = false;
+    if (level.records)   { return; }
+
+    if (first == false)   { put(','); }
+    if (indent >= 0)      { newline(levels.size()); }
+}
+
+void JsonWriter::afterValue()
+{
+    if (format == ExportFormat::NDJson)
+    {
+        if (levels.empty() || levels.back().records)   { put('\n'); }
+        return;
+    }
+
+    if (isBinaryFormat(format) && collecting.empty() && levels.empty() == false && levels.back().records)
+    {
+        if (levels.back().remaining == 0)   { throw logic_error("More array elements written than its count"); }
+        --levels.back().remaining;
+    }
+}
+
+void JsonWriter::open(char bracket, bool object, bool counted, uint64_t count)
+{
+    beforeValue();
+
+    Level level{ object };
+    bool topLevelArray = levels.empty() && object == false;
+
+    if (isBinaryFormat(format))
+    {
+        if (topLevelArray && counted)
+        {
+            arrayHeader(count);
+            level.records = true;
+            level.remaining = count;
+        }
+        else
+        {
+            collecting.push_back(&collect(object ? nlohmann::json::object() : nlohmann::json::array()));
+        }
+    }
+    else if (topLevelArray && format == ExportFormat::NDJson)
+    {
+        level.records = true;
+    }
+    else
+    {
+        put(bracket);
+    }
+
+    levels.push_back(level);
+}
+
+void JsonWriter::close(char bracket)
+{
+    Level level = levels.back();
+    levels.pop_back();
+
+    if (isBinaryFormat(format))
+    {
+        if (level.records)
+        {
+            if (level.remaining != 0)   { throw logic_error("Fewer array elements written than its count"); }
+            return;
+        }
+
+        collecting.pop_back();
+        if (collecting.empty())
+        {
+            encode(document);
+            document = nullptr;
+        }
+        afterValue();
+        return;
+    }
+
+    if (level.records)   { return; }
+
+    if (level.empty == false && indent >= 0)   { newline(levels.size()); }
+    put(bracket);
+    afterValue();
+}
+
+void JsonWriter::beginObject()                 { open('{', true, false, 0); }
+void JsonWriter::endObject()                   { close('}'); }
+void JsonWriter::beginArray()                  { open('[', false, false, 0); }
+void JsonWriter::beginArray(uint64_t count)    { open('[', false, true, count); }
+void JsonWriter::endArray()                    { close(']'); }
+
+void JsonWriter::key(string_view name)
+{
+    if (isBinaryFormat(format))
+    {
+        pendingKey.assign(name);
+        return;
+    }
+
+    beforeValue();
+    quoted(name);
+    if (indent >= 0)   { put(": ", 2); }
+    else               { put(':'); }
+    afterKey = true;
+}
+
+
+/* ---------------- Binary Formats ---------------- */
+
+nlohmann::json& JsonWriter::collect(nlohmann::json&& v)
+{
+    if (collecting.empty())
+    {
+        document = move(v);
+        return document;
+    }
+
+    nlohmann::json& parent = *collecting.back();
+    if (parent.is_array())
+    {
+        parent.push_back(move(v));
+        return parent.back();
+    }
+
+    nlohmann::json& slot = parent[pendingKey];
+    slot = move(v);
+    return slot;
+}
+
+void JsonWriter::encode(const nlohmann::json& v)
+{
+    encoded.clear();
+    if (format == ExportFormat::Cbor)   { nlohmann::json::to_cbor(v, encoded); }
+    else                                { nlohmann::json::to_msgpack(v, encoded); }
+    put(encoded.data(), encoded.size());
+}
+
+/* The header nlohmann writes in front of an array of 'count' elements */
+void JsonWriter::arrayHeader(uint64_t count)
+{
+    auto bigEndian = [this](uint64_t v, int bytes) {
+        for (int b = bytes - 1; b >= 0; --b)   { put((char)((v >> (8 * b)) & 0xFF)); }
+    };
+
+    if (format == ExportFormat::Cbor)
+    {
+        if (count <= 0x17)              { put((char)(0x80 + count)); }
+        else if (count <= 0xFF)         { put((char)0x98); bigEndian(count, 1); }
+        else if (count <= 0xFFFF)       { put((char)0x99); bigEndian(count, 2); }
+        else if (count <= 0xFFFFFFFF)   { put((char)0x9A); bigEndian(count, 4); }
+        else                            { put((char)0x9B); bigEndian(count, 8); }
+    }
+    else
+    {
+        if (count <= 15)                { put((char)(0x90 | count)); }
+        else if (count <= 0xFFFF)       { put((char)0xDC); bigEndian(count, 2); }
+        else if (count <= 0xFFFFFFFF)   { put((char)0xDD); bigEndian(count, 4); }
+        else                            { throw length_error("MessagePack arrays hold at most 2^32-1 elements"); }
+    }
+}
+
+/* Scalars in the binary formats: collected into the open document, or encoded on their own at the top level */
+void JsonWriter::scalar(nlohmann::json&& v)
+{
+    nlohmann::json& placed = collect(move(v));
+    if (collecting.empty())
+    {
+        encode(placed);
+        document = nullptr;
+    }
+    afterValue();
+}
+
+
+/* ---------------- Values ---------------- */
+
+void JsonWriter::quoted(string_view s)
+{
+    /* Plain ASCII without quotes, backslashes or control characters is written as is; anything else goes
+       through nlohmann so escaping and UTF-8 validation stay exactly the same */
+    for (unsigned char c : s)
+    {
+        if (c < 0x20 || c >= 0x80 || c == '"' || c == '\\')
+        {
+            string escaped = nlohmann::json(string(s)).dump();
+            put(escaped.data(), escaped.size());
+            return;
+        }
+    }
+
+    put('"');
+    put(s.data(), s.size());
+    put('"');
+}
+
+void JsonWriter::value(string_view s)
+{
+    if (isBinaryFormat(format))   { scalar(nlohmann::json(string(s))); return; }
+
+    beforeValue();
+    quoted(s);
+    afterValue();
+}
+
+void JsonWriter::value(int64_t n)
+{
+    if (isBinaryFormat(format))   { scalar(nlohmann::json(n)); return; }
+
+    beforeValue();
+    char digits[24];
+    auto end = to_chars(digits, digits + sizeof(digits), n).ptr;
+    put(digits, end - digits);
+    afterValue();
+}
+
+void JsonWriter::value(uint64_t n)
+{
+    if (isBinaryFormat(format))   { scalar(nlohmann::json(n)); return; }
+
+    beforeValue();
+    char digits[24];
+    auto end = to_chars(digits, digits + sizeof(digits), n).ptr;
+    put(digits, end - digits);
+    afterValue();
+}
+
+void JsonWriter::value(double d)
+{
+    if (isBinaryFormat(format))   { scalar(nlohmann::json(d)); return; }
+
+    beforeValue();
+    if (isfinite(d) == false)
+    {
+        put("null", 4);
+    }
+    else
+    {
+        /* Same shortest round-trip formatting nlohmann's serializer uses */
+        char digits[64];
+        char* end = nlohmann::detail::to_chars(digits, digits + sizeof(digits), d);
+        put(digits, end - digits);
+    }
+    afterValue();
+}
+
+void JsonWriter::value(bool b)
+{
+    if (isBinaryFormat(format))   { scalar(nlohmann::json(b)); return; }
+
+    beforeValue();
+    if (b)   { put("true", 4); }
+    else     { put("false", 5); }
+    afterValue();
+}
+
+void JsonWriter::null()
+{
+    if (isBinaryFormat(format))   { scalar(nlohmann::json(nullptr)); return; }
+
+    beforeValue();
+    put("null", 4);
+    afterValue();
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/* Encodings an export can be written in:
+   Json         pretty-printed with 2-space indentation, what the dashboard reads
+   CompactJson  no whitespace at all
+   NDJson       one compact JSON document per line; a top-level array becomes one line per element
+   Cbor         RFC 8949 binary, as nlohmann::json::to_cbor encodes it
+   MessagePack  as nlohmann::json::to_msgpack encodes it */
+enum class ExportFormat { Json, CompactJson, NDJson, Cbor, MessagePack };
+
+/* Names used by the menu: json, compact, ndjson, cbor, msgpack. parseExportFormat throws invalid_argument on unknown names. */
+ExportFormat parseExportFormat(const string& name);
+string exportFormatName(ExportFormat format);
+
+/* File extension, dot included: .json for both JSON forms, .ndjson, .cbor, .msgpack */
+string exportFormatExtension(ExportFormat format);
+
+bool isBinaryFormat(ExportFormat format);
+
+/* Streaming serializer: values go straight into a fixed-size buffer that is flushed to the stream when full,
+   so writing an array costs the same memory whatever its length. The text output matches
+   nlohmann::json::dump(2) (Json) or dump() (CompactJson) byte for byte, as long as keys are written in sorted
+   order (nlohmann objects keep their keys in a std::map).
+   The binary formats encode one top-level array element at a time with nlohmann's encoders, which needs the
+   element count up front: pass it to beginArray(count). Any other top-level value is collected whole and
+   encoded when it closes. */
+class JsonWriter
+{
+    private:
+
+        static const size_t BUFFER_SIZE = 1 << 16;
+
+        struct Level
+        {
+            bool object;
+            bool empty = true;
+            bool records = false;       /* top-level array written element by element (NDJSON lines, binary) */
+            uint64_t remaining = 0;     /* binary records: elements still owed to the count in the header */
+        };
+
+        ostream& out;
+        ExportFormat format;
+        int indent;                     /* -1 for compact text */
+        vector<Level> levels;           /* open arrays and objects, innermost last */
+        bool afterKey = false;          /* a key was written and its value is next */
+        char buffer[BUFFER_SIZE];
+        size_t used = 0;
+
+        /* Binary formats: the value being collected, the open containers inside it, and the pending key */
+        nlohmann::json document;
+        vector<nlohmann::json*> collecting;
+        string pendingKey;
+        string encoded;
+
+        void put(char c)
+        {
+            if (used == BUFFER_SIZE)   { flush(); }
+            buffer[used++] = c;
+        }
+
+        void put(const char* s, size_t n);
+        void newline(size_t depth);
+
+        /* Separator and indentation owed before the next key or value */
+        void beforeValue();
+        /* Bookkeeping after a complete value: ends NDJSON lines and counts binary records */
+        void afterValue();
+        void open(char bracket, bool object, bool counted, uint64_t count);
+        void close(char bracket);
+        void quoted(string_view s);
+
+        /* Binary formats: place a value in the document being collected, under the pending key if the innermost
+           container is an object */
+        nlohmann::json& collect(nlohmann::json&& v);
+        void encode(const nlohmann::json& v);
+        void arrayHeader(uint64_t count);
+        void scalar(nlohmann::json&& v);
+
+    public:
+
+        /* The stream is not touched until the buffer fills or flush() runs; binary formats want an ios::binary stream */
+        explicit JsonWriter(ostream& out, ExportFormat format = ExportFormat::Json);
+        ~JsonWriter();
+
+        JsonWriter(const JsonWriter&) = delete;
+        JsonWriter& operator=(const JsonWriter&) = delete;
+
+        ExportFormat getFormat() const   { return format; }
+
+        void beginObject();
+        void endObject();
+        void beginArray();
+        /* Array that will hold exactly count elements; throws logic_error at endArray if it does not */
+        void beginArray(uint64_t count);
+        void endArray();
+
+        /* Name of the next member of the innermost object */
+        void key(string_view name);
+
+        void value(string_view s);
+        void value(const char* s)       { value(string_view(s)); }
+        void value(const string& s)     { value(string_view(s)); }
+        void value(int64_t n);
+        void value(int n)               { value((int64_t)n); }
+        void value(uint64_t n);
+        void value(double d);           /* the text formats write NaN and infinities as null, like nlohmann */
+        void value(bool b);
+        void null();
+
+        /* key(name) then value(v) */
+        template<typename T>
+        void member(string_view name, const T& v)
+        {
+            key(name);
+            value(v);
+        }
+
+        /* Hand everything buffered so far to the stream */
+        void flush();
+};
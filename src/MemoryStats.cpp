@@ -0,0 +1,236 @@
+#include "MemoryStats.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <algorithm>
+
+#if defined(__linux__) || defined(_WIN32)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#endif
+
+using namespace std;
+
+
+/* ---------------- Counting Allocator ---------------- */
+
+static atomic<uint64_t> allocationCount{ 0 };
+static atomic<uint64_t> allocatedBytes{ 0 };
+static atomic<int64_t> liveBytes{ 0 };
+static atomic<int64_t> peakLiveBytes{ 0 };
+
+/* Bytes the allocator really set aside for 'p', 0 where it cannot tell */
+static size_t usableSize(void* p)
+{
+#if defined(__linux__)
+    return malloc_usable_size(p);
+#elif defined(_WIN32)
+    return _msize(p);
+#elif defined(__APPLE__)
+    return malloc_size(p);
+#else
+    (void)p;
+    return 0;
+#endif
+}
+
+static void* allocate(size_t size)
+{
+    if (size == 0)   { size = 1; }
+
+    void* p;
+    while ((p = malloc(size)) == nullptr)
+    {
+        new_handler handler = get_new_handler();
+        if (handler == nullptr)   { throw bad_alloc(); }
+        handler();
+    }
+
+    if (MemoryStats::isEnabled())
+    {
+        allocationCount.fetch_add(1, memory_order_relaxed);
+        allocatedBytes.fetch_add(size, memory_order_relaxed);
+
+        int64_t usable = (int64_t)usableSize(p);
+        int64_t live = liveBytes.fetch_add(usable, memory_order_relaxed) + usable;
+        int64_t peak = peakLiveBytes.load(memory_order_relaxed);
+        while (live > peak && peakLiveBytes.compare_exchange_weak(peak, live, memory_order_relaxed) == false) {}
+    }
+    return p;
+}
+
+static void release(void* p) noexcept
+{
+    if (p == nullptr)   { return; }
+    if (MemoryStats::isEnabled())   { liveBytes.fetch_sub((int64_t)usableSize(p), memory_order_relaxed); }
+    free(p);
+}
+
+void* operator new(size_t size)                                  { return allocate(size); }
+void* operator new[](size_t size)                                { return allocate(size); }
+void operator delete(void* p) noexcept                           { release(p); }
+void operator delete[](void* p) noexcept                         { release(p); }
+void operator delete(void* p, size_t) noexcept                   { release(p); }
+void operator delete[](void* p, size_t) noexcept                 { release(p); }
+void operator delete(void* p, const nothrow_t&) noexcept         { release(p); }
+void operator delete[](void* p, const nothrow_t&) noexcept       { release(p); }
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+
+/* ---------------- Memory Stats ---------------- */
+
+MemoryCounters MemoryStats::counters()
+{
+    MemoryCounters c;
+    c.allocations = allocationCount.load(memory_order_relaxed);
+    c.bytesAllocated = allocatedBytes.load(memory_order_relaxed);
+    c.liveBytes = liveBytes.load(memory_order_relaxed);
+    c.peakLiveBytes = peakLiveBytes.load(memory_order_relaxed);
+    return c;
+}
+
+void MemoryStats::resetPeak()
+{
+    peakLiveBytes.store(liveBytes.load(memory_order_relaxed), memory_order_relaxed);
+}
+
+/* A "Name:   1234 kB" line of /proc/self/status in bytes. Read with stdio, which allocates through malloc,
+   so a measurement does not count itself. */
+static uint64_t statusField(const char* name)
+{
+    FILE* status = fopen("/proc/self/status", "r");
+    if (status == nullptr)   { return 0; }
+
+    char line[256];
+    size_t length = strlen(name);
+    uint64_t kb = 0;
+    while (fgets(line, sizeof(line), status) != nullptr)
+    {
+        if (strncmp(line, name, length) == 0 && line[length] == ':')
+        {
+            kb = strtoull(line + length + 1, nullptr, 10);
+            break;
+        }
+    }
+    fclose(status);
+    return kb * 1024;
+}
+
+uint64_t MemoryStats::residentBytes()       { return statusField("VmRSS"); }
+uint64_t MemoryStats::peakResidentBytes()   { return statusField("VmHWM"); }
+
+bool MemoryStats::resetPeakResident()
+{
+    FILE* clearRefs = fopen("/proc/self/clear_refs", "w");
+    if (clearRefs == nullptr)   { return false; }
+
+    bool ok = fputs("5", clearRefs) >= 0;
+    return fclose(clearRefs) == 0 && ok;
+}
+
+
+/* ---------------- Operation Scopes ---------------- */
+
+static mutex reportLock;
+static vector<MemoryUsage> records;
+static vector<MemoryScope*> openScopes;
+static thread::id scopeThread;         /* the thread of the first scope; the only one whose scopes count */
+
+MemoryScope::MemoryScope(const string& operation) : record(SIZE_MAX)
+{
+    if (MemoryStats::isEnabled() == false)   { return; }
+
+    {
+        lock_guard<mutex> guard(reportLock);
+        if (records.empty())   { scopeThread = this_thread::get_id(); }
+        if (this_thread::get_id() != scopeThread)   { return; }
+
+        record = records.size();
+        records.push_back({ operation, (int)openScopes.size() });
+        openScopes.push_back(this);
+    }
+
+    residentPeakBefore = MemoryStats::peakResidentBytes();
+    residentReset = MemoryStats::resetPeakResident();
+
+    /* counters() keeps the enclosing scope's high-water mark in start.peakLiveBytes, for the destructor to restore */
+    start = MemoryStats::counters();
+    MemoryStats::resetPeak();
+}
+
+MemoryScope::~MemoryScope()
+{
+    if (record == SIZE_MAX)   { return; }
+
+    MemoryCounters end = MemoryStats::counters();
+    uint64_t resident = MemoryStats::residentBytes();
+    uint64_t residentPeak = max(MemoryStats::peakResidentBytes(), innerResidentPeak);
+    if (residentReset == false)   { residentPeak = max(residentPeak, residentPeakBefore); }
+
+    /* The enclosing scope's peaks include this one's */
+    peakLiveBytes.store(max(start.peakLiveBytes, end.peakLiveBytes), memory_order_relaxed);
+
+    lock_guard<mutex> guard(reportLock);
+    MemoryUsage& usage = records[record];
+    usage.allocations = end.allocations - start.allocations;
+    usage.bytesAllocated = end.bytesAllocated - start.bytesAllocated;
+    usage.peakHeapBytes = end.peakLiveBytes - start.liveBytes;
+    usage.residentBytes = resident;
+    usage.peakResidentBytes = residentPeak;
+
+    openScopes.pop_back();
+    if (openScopes.empty() == false)
+    {
+        MemoryScope& outer = *openScopes.back();
+        outer.innerResidentPeak = max({ outer.innerResidentPeak, residentPeakBefore, residentPeak });
+    }
+}
+
+vector<MemoryUsage> MemoryScope::report()
+{
+    lock_guard<mutex> guard(reportLock);
+    return records;
+}
+
+void MemoryScope::writeReport(ostream& out)
+{
+    auto mb = [](double bytes) { return bytes / (1 << 20); };
+
+    out << left << setw(26) << "operation" << right << setw(12) << "allocs" << setw(12) << "MB alloc"
+        << setw(14) << "peak heap MB" << setw(10) << "RSS MB" << setw(14) << "peak RSS MB" << "\n";
+    for (const auto& usage : report())
+    {
+        out << left << setw(26) << string(2 * usage.depth, ' ') + usage.operation << right
+            << setw(12) << usage.allocations << fixed << setprecision(1)
+            << setw(12) << mb(usage.bytesAllocated) << setw(14) << mb(usage.peakHeapBytes)
+            << setw(10) << mb(usage.residentBytes) << setw(14) << mb(usage.peakResidentBytes) << defaultfloat << "\n";
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/* ---------------- Allocation Accounting ---------------- */
+/* Linking this module replaces the global operator new and delete with versions that count, while counting is
+   enabled, every allocation, the bytes requested and the heap bytes live, with their high-water mark. Disabled,
+   they cost one relaxed atomic load on top of malloc and free. Live bytes are the allocator's usable sizes, so
+   they include its rounding; over-aligned allocations (new with align_val_t) are not counted.
+   The resident-set figures come from /proc/self/status and are 0 on systems without it. */
+
+struct MemoryCounters
+{
+    uint64_t allocations = 0;
+    uint64_t bytesAllocated = 0;        /* requested, cumulative */
+    int64_t liveBytes = 0;              /* allocated minus freed while counting */
+    int64_t peakLiveBytes = 0;          /* high-water mark of liveBytes since the last resetPeak() */
+};
+
+class MemoryStats
+{
+    private:
+
+        static inline atomic<bool> enabled{ false };
+
+    public:
+
+        static void enable(bool on = true)   { enabled.store(on, memory_order_relaxed); }
+        static bool isEnabled()              { return enabled.load(memory_order_relaxed); }
+
+        static MemoryCounters counters();
+
+        /* Restart the high-water mark from the bytes live now */
+        static void resetPeak();
+
+        /* VmRSS and VmHWM */
+        static uint64_t residentBytes();
+        static uint64_t peakResidentBytes();
+
+        /* Restart VmHWM from the current resident set (Linux 4.0 and later); false if that is not possible */
+        static bool resetPeakResident();
+};
+
+/* ---------------- Operation Scopes ---------------- */
+/* What one operation cost in memory */
+struct MemoryUsage
+{
+    string operation;
+    int depth;                          /* scopes open around it */
+    uint64_t allocations = 0;
+    uint64_t bytesAllocated = 0;
+    int64_t peakHeapBytes = 0;          /* highest live heap bytes above those live when it started */
+    uint64_t residentBytes = 0;         /* at its end */
+    uint64_t peakResidentBytes = 0;     /* while it ran, when VmHWM could be reset; else the process peak */
+};
+
+/* Measures its own lifetime as one operation while counting is enabled, and adds it to a report kept for the
+   whole run. Scopes may nest (an inner scope's peaks count towards the outer one's too) but belong to one
+   thread: only those opened on the thread of the first one are recorded, the others do nothing. Allocations on
+   other threads still count towards the open scopes. */
+class MemoryScope
+{
+    private:
+
+        size_t record;                  /* index into the report, or SIZE_MAX when counting is off */
+        MemoryCounters start;
+        uint64_t residentPeakBefore = 0;    /* VmHWM before this scope reset it */
+        uint64_t innerResidentPeak = 0;     /* highest VmHWM seen by scopes nested in this one */
+        bool residentReset = false;
+
+    public:
+
+        explicit MemoryScope(const string& operation);
+        ~MemoryScope();
+
+        MemoryScope(const MemoryScope&) = delete;
+        MemoryScope& operator=(const MemoryScope&) = delete;
+
+        /* Every finished operation, in the order they started */
+        static vector<MemoryUsage> report();
+
+        /* The report as a table, nested operations indented under theirs */
+        static void writeReport(ostream& out);
+};
@@ -2,6 +2,7 @@
 
 #include "MinHeap.h"
 #include "User.h"
+#include "ThreadPool.h"
 #include <algorithm>  
 #include <filesystem>
 #include <limits>
@@ -38,9 +39,7 @@ void MinHeap<T>::heapifyUp(int i)
     while (i > 0 
            && heap[i] < heap[getParent(i)])
     {
-        T temp = heap[i];
-        heap[i] = heap[getParent(i)];
-        heap[getParent(i)] = temp;
+        swap(heap[i], heap[getParent(i)]);
         i = getParent(i);
     }
 
@@ -54,16 +53,14 @@ void MinHeap<T>::heapifyDown(int i)
     int right = getRChild(i);
     int smallest = i;
 
-    if (left < heap.size() && heap[left] < heap[smallest])  { smallest = left; }
+    if (left < (int)heap.size() && heap[left] < heap[smallest])  { smallest = left; }
 
-    if (right < heap.size() && heap[right] < heap[smallest])    { smallest = right; }
+    if (right < (int)heap.size() && heap[right] < heap[smallest])    { smallest = right; }
     
     /* If the child is smaller than the current element in the heap, swap them both */
     if (smallest != i) 
     {
-        T temp = heap[i];
-        heap[i] = heap[smallest];
-        heap[smallest] = temp;
+        swap(heap[i], heap[smallest]);
         heapifyDown(smallest);
     }
 
@@ -76,8 +73,6 @@ void MinHeap<T>::insert(const T& element)
     heap.push_back(element);
     heapifyUp(heap.size() - 1);
 
-    if (heap.size() > capacity)   { removeMin(); }
-
 }
 
 /* Return the root of the heap */
@@ -98,13 +93,29 @@ void MinHeap<T>::removeMin()
     /* If no root, throw error messsage */
     if (heap.empty() == true)   { throw runtime_error("Heap is empty!"); }
 
-    heap[0] = heap[heap.size() - 1];
+    heap[0] = move(heap.back());
     heap.pop_back();
 
     if (heap.empty() == false)  { heapifyDown(0); }
 
 }
 
+/* Insert each element of the other heap; the heap property of 'other' is irrelevant here */
+template <typename T>
+void MinHeap<T>::merge(const MinHeap& other)
+{
+    reserve(heap.size() + other.heap.size());
+
+    for (const T& element : other.heap)   { insert(element); }
+
+}
+
+template <typename T>
+void MinHeap<T>::reserve(unsigned int n)   { heap.reserve(n); }
+
+template <typename T>
+void MinHeap<T>::shrink_to_fit()   { heap.shrink_to_fit(); }
+
 template class MinHeap<UserSimilarity>;
 
 
@@ -171,6 +182,29 @@ void FixedMinHeap<T>::removeMin()
 template<typename T>
 unsigned int FixedMinHeap<T>::size() const   { return heap.size(); }
 
+template<typename T>
+unsigned int FixedMinHeap<T>::getCapacity() const   { return capacity; }
+
+/* Once full, an incoming element only enters if it beats the root, and then it replaces the root directly */
+template<typename T>
+void FixedMinHeap<T>::merge(const FixedMinHeap& other)
+{
+    if (capacity == 0) return;
+    for (const T& val : other.heap)
+    {
+        if (heap.size() < capacity)
+        {
+            heap.push_back(val);
+            heapifyUp((int)heap.size() - 1);
+        }
+        else if (heap[0] < val)
+        {
+            heap[0] = val;
+            heapifyDown(0);
+        }
+    }
+}
+
 template<typename T>
 FixedMinHeap<T>::FixedMinHeap(unsigned int capacity)
     : capacity(capacity)
@@ -180,3 +214,37 @@ template<typename T>
 bool FixedMinHeap<T>::empty() const  { return heap.empty(); }
 
 template class FixedMinHeap<UserWatch>;
+template class FixedMinHeap<RowWatch>;
+
+
+/* ---------------- Heap Reduction ---------------- */
+
+template<typename Heap>
+Heap reduceHeaps(vector<Heap>& heaps, bool concurrent)
+{
+    if (heaps.empty())   { throw runtime_error("No heaps to reduce!"); }
+
+    /* Round r merges heaps[i + 2^r] into heaps[i]; the survivor of every round sits at a multiple of 2^(r+1) */
+    for (size_t stride = 1; stride < heaps.size(); stride *= 2)
+    {
+        TaskGroup round;
+        for (size_t i = 0; i + stride < heaps.size(); i += 2 * stride)
+        {
+            if (concurrent)
+            {
+                round.run([&heaps, i, stride]() { heaps[i].merge(heaps[i + stride]); });
+            }
+            else
+            {
+                heaps[i].merge(heaps[i + stride]);
+            }
+        }
+        round.wait();
+    }
+
+    return move(heaps[0]);
+}
+
+template FixedMinHeap<UserWatch> reduceHeaps(vector<FixedMinHeap<UserWatch>>& heaps, bool concurrent);
+template FixedMinHeap<RowWatch> reduceHeaps(vector<FixedMinHeap<RowWatch>>& heaps, bool concurrent);
+template MinHeap<UserSimilarity> reduceHeaps(vector<MinHeap<UserSimilarity>>& heaps, bool concurrent);
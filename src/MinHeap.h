@@ -15,12 +15,12 @@ using namespace std;
 template <typename T>
 
 /* ---------------- Unbounded MinHeap (option 6) ---------------- */
+/* Growable priority queue: insert never evicts. Call reserve() with the expected element count up front so a fill never reallocates. */
 class MinHeap 
 {
     private:
 
         vector <T> heap;
-        unsigned int capacity;
 
         int getParent(int i);
         int getLChild(int i);
@@ -37,6 +37,13 @@ class MinHeap
         T getMin() const;
         void removeMin();
 
+        /* Insert every element of another heap into this one */
+        void merge(const MinHeap& other);
+
+        /* Pre-size the storage for n elements / release storage beyond the current size */
+        void reserve(unsigned int n);
+        void shrink_to_fit();
+
 
 };
 
@@ -53,6 +60,10 @@ class FixedMinHeap
         T getMin() const;
         void removeMin();
         unsigned int size()  const;
+        unsigned int getCapacity() const;
+
+        /* Fold another heap into this one, keeping only the 'capacity' largest elements */
+        void merge(const FixedMinHeap& other);
 
     private:
 
@@ -65,3 +76,10 @@ class FixedMinHeap
         void heapifyUp(int i);
         void heapifyDown(int i);
 };
+
+/* ---------------- Heap Reduction ---------------- */
+
+/* Merge P per-thread heaps pairwise in log2(P) rounds, O(P * k log k) total for heaps of k elements.
+   With 'concurrent' set, the pairs of each round are merged as tasks on the shared ThreadPool. The heaps are consumed. */
+template<typename Heap>
+Heap reduceHeaps(vector<Heap>& heaps, bool concurrent = false);
@@ -0,0 +1,90 @@
+#include "PackedUser.h"
+#include <stdexcept>
+
+using namespace std;
+
+
+PackedUsers::PackedUsers(const vector<User>& users)
+{
+    size_t nameBytes = 0;
+    for (const auto& user : users)   { nameBytes += user.name.size(); }
+
+    reserve(users.size(), nameBytes);
+    for (const auto& user : users)   { pack(user); }
+}
+
+void PackedUsers::reserve(size_t users, size_t nameBytes)
+{
+    records.reserve(records.size() + users);
+    names.reserve(names.size() + nameBytes);
+}
+
+void PackedUsers::pack(const User& user)
+{
+    PackedUser packed;
+    packed.watchTime = user.watchTime;
+    packed.userID = user.userID;
+    packed.lastLoginDay = parseDay(user.lastLogin);
+
+    /* A lastLogin that is not a date is kept as it is, right after the name */
+    string_view loginText = packed.lastLoginDay == NO_DAY ? string_view(user.lastLogin) : string_view();
+
+    if (user.age < INT16_MIN || user.age > INT16_MAX)   { throw length_error("Age does not fit a packed user: " + to_string(user.age)); }
+    if (user.name.size() > UINT16_MAX || loginText.size() > UINT16_MAX)   { throw length_error("Name too long for a packed user"); }
+    if (names.size() + user.name.size() + loginText.size() > UINT32_MAX)   { throw length_error("Packed user names exceed 4 GB"); }
+
+    packed.nameOffset = (uint32_t)names.size();
+    packed.nameLength = (uint16_t)user.name.size();
+    packed.loginLength = (uint16_t)loginText.size();
+    names += user.name;
+    names += loginText;
+
+    packed.age = (int16_t)user.age;
+    packed.country = countries.encode(user.country);
+    packed.subscription = subscriptions.encode(user.subscription);
+    packed.genre = genres.encode(user.genre);
+
+    records.push_back(packed);
+}
+
+string PackedUsers::lastLogin(const PackedUser& user) const
+{
+    if (user.lastLoginDay != NO_DAY)   { return civilFromDays(user.lastLoginDay); }
+    return names.substr((size_t)user.nameOffset + user.nameLength, user.loginLength);
+}
+
+User PackedUsers::unpack(size_t i) const
+{
+    const PackedUser& packed = records.at(i);
+
+    User user;
+    user.userID = packed.userID;
+    user.name = string(name(packed));
+    user.age = packed.age;
+    user.country = country(packed);
+    user.subscription = subscription(packed);
+    user.watchTime = packed.watchTime;
+    user.genre = genre(packed);
+    user.lastLogin = lastLogin(packed);
+    return user;
+}
+
+vector<User> PackedUsers::unpackAll() const
+{
+    vector<User> users;
+    users.reserve(records.size());
+    for (size_t i = 0; i < records.size(); ++i)   { users.push_back(unpack(i)); }
+    return users;
+}
+
+size_t PackedUsers::memoryBytes() const
+{
+    size_t bytes = sizeof(*this) + records.capacity() * sizeof(PackedUser) + names.capacity();
+
+    /* A dictionary holds each value twice: in its list and as a key of its map */
+    for (const Dictionary* dictionary : { &countries, &subscriptions, &genres })
+    {
+        for (unsigned int code = 0; code < dictionary->size(); ++code)   { bytes += 2 * (sizeof(string) + dictionary->decode(code).capacity()); }
+    }
+    return bytes;
+}
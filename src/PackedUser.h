@@ -0,0 +1,78 @@
+#pragma once
+
+#include "User.h"
+#include "UserTable.h"
+#include "Dates.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/* ---------------- Packed User ---------------- */
+/* One user in 32 bytes instead of a User's ~200 (five std::strings plus whatever they spill to the heap):
+   the categorical fields as codes into the owning PackedUsers' dictionaries, lastLogin as a day number and
+   the name as a slice of one string shared by every user. Only meaningful next to the PackedUsers it came
+   from. */
+struct PackedUser
+{
+    double watchTime;
+    int32_t userID;
+    int32_t lastLoginDay;       /* NO_DAY when lastLogin is not a YYYY-MM-DD date, kept as text after the name */
+    uint32_t nameOffset;        /* into the shared names */
+    uint16_t nameLength;
+    uint16_t loginLength;       /* length of the text kept for a lastLogin that is not a date, else 0 */
+    int16_t age;
+    uint16_t country;
+    uint16_t subscription;
+    uint16_t genre;
+};
+
+static_assert(sizeof(PackedUser) == 32, "PackedUser is meant to fill half a cache line");
+
+/* ---------------- Packed Users ---------------- */
+/* Users stored as PackedUser records over one name arena and three dictionaries. Converts to and from User
+   losslessly: unpack(pack(u)) == u field by field, whatever lastLogin holds. Ages must fit in 16 bits and names
+   in 65535 bytes, and the arena is limited to 4 GB; pack() throws length_error otherwise. */
+class PackedUsers
+{
+    private:
+
+        vector<PackedUser> records;
+        string names;
+        Dictionary countries;
+        Dictionary subscriptions;
+        Dictionary genres;
+
+    public:
+
+        PackedUsers() = default;
+        explicit PackedUsers(const vector<User>& users);
+
+        /* Room for 'users' more users with 'nameBytes' of names between them */
+        void reserve(size_t users, size_t nameBytes = 0);
+
+        void pack(const User& user);
+
+        size_t size() const                               { return records.size(); }
+        const PackedUser& operator[](size_t i) const      { return records[i]; }
+        const vector<PackedUser>& getRecords() const      { return records; }
+
+        string_view name(const PackedUser& user) const    { return string_view(names).substr(user.nameOffset, user.nameLength); }
+        const string& country(const PackedUser& user) const        { return countries.decode(user.country); }
+        const string& subscription(const PackedUser& user) const   { return subscriptions.decode(user.subscription); }
+        const string& genre(const PackedUser& user) const          { return genres.decode(user.genre); }
+        string lastLogin(const PackedUser& user) const;
+
+        const Dictionary& getCountries() const       { return countries; }
+        const Dictionary& getSubscriptions() const   { return subscriptions; }
+        const Dictionary& getGenres() const          { return genres; }
+
+        /* The User record i was packed from */
+        User unpack(size_t i) const;
+        vector<User> unpackAll() const;
+
+        /* Bytes held: the records, the name arena and the dictionaries' strings */
+        size_t memoryBytes() const;
+};
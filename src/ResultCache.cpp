@@ -0,0 +1,123 @@
+#include "ResultCache.h"
+
+using namespace std;
+
+
+ResultCache::ResultCache(size_t budgetBytes) : budget(budgetBytes) {}
+
+string ResultCache::keyFor(const string& operation, const string& params, uint64_t version)
+{
+    /* '\0' cannot appear in an operation name, so distinct (operation, params) pairs give distinct keys */
+    string key = operation;
+    key += '\0';
+    key += params;
+    key += '\0';
+    key += to_string(version);
+    return key;
+}
+
+void ResultCache::dropAll()
+{
+    entries.clear();
+    byKey.clear();
+    used = 0;
+}
+
+void ResultCache::evictDownTo(size_t limit)
+{
+    while (used > limit && entries.empty() == false)
+    {
+        used -= entries.back().bytes;
+        byKey.erase(entries.back().key);
+        entries.pop_back();
+        ++evictions;
+    }
+}
+
+shared_ptr<const void> ResultCache::find(const string& key, uint64_t version)
+{
+    lock_guard<mutex> guard(lock);
+    if (version > this->version)
+    {
+        dropAll();
+        this->version = version;
+    }
+
+    auto it = byKey.find(key);
+    if (it == byKey.end())
+    {
+        ++misses;
+        return nullptr;
+    }
+
+    entries.splice(entries.begin(), entries, it->second);
+    ++hits;
+    return it->second->value;
+}
+
+void ResultCache::insert(const string& key, uint64_t version, shared_ptr<const void> value, size_t bytes)
+{
+    lock_guard<mutex> guard(lock);
+
+    /* Computed from data that has since been replaced, already cached by a faster thread, or too big to keep */
+    if (version < this->version || byKey.count(key) || bytes > budget)   { return; }
+
+    evictDownTo(budget - bytes);
+    entries.push_front({ key, move(value), bytes });
+    byKey[key] = entries.begin();
+    used += bytes;
+}
+
+void ResultCache::invalidate(uint64_t version)
+{
+    lock_guard<mutex> guard(lock);
+    if (version <= this->version)   { return; }
+
+    dropAll();
+    this->version = version;
+}
+
+void ResultCache::clear()
+{
+    lock_guard<mutex> guard(lock);
+    dropAll();
+}
+
+void ResultCache::setBudget(size_t budgetBytes)
+{
+    lock_guard<mutex> guard(lock);
+    budget = budgetBytes;
+    evictDownTo(budget);
+}
+
+size_t ResultCache::getBytes() const
+{
+    lock_guard<mutex> guard(lock);
+    return used;
+}
+
+size_t ResultCache::getEntries() const
+{
+    lock_guard<mutex> guard(lock);
+    return entries.size();
+}
+
+void ResultCache::writeStats(JsonWriter& writer) const
+{
+    size_t bytes, count, limit;
+    {
+        lock_guard<mutex> guard(lock);
+        bytes = used;
+        count = entries.size();
+        limit = budget;
+    }
+
+    writer.beginObject();
+    writer.member("budgetBytes", (uint64_t)limit);
+    writer.member("bytes", (uint64_t)bytes);
+    writer.member("entries", (uint64_t)count);
+    writer.member("evictions", evictions.load());
+    writer.member("hits", hits.load());
+    writer.member("misses", misses.load());
+    writer.endObject();
+}
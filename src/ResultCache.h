@@ -0,0 +1,90 @@
+#pragma once
+
+#include "JsonWriter.h"
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+using namespace std;
+
+/* ---------------- Result Cache ---------------- */
+/* Results of analyses keyed by (operation, parameters, dataset version), evicted least recently used first once
+   their estimated size passes a byte budget. Values are shared and immutable, so a hit costs a map lookup and
+   a reference count, and a result stays valid for whoever holds it after it is evicted.
+   A lookup under a newer dataset version drops everything cached for older ones, so results never outlive the
+   data they were computed from. Safe to share between threads; two threads missing the same key at once both
+   compute it, and the first to finish is kept. */
+class ResultCache
+{
+    private:
+
+        struct Entry
+        {
+            string key;
+            shared_ptr<const void> value;
+            size_t bytes;
+        };
+
+        size_t budget;
+        size_t used = 0;
+        uint64_t version = 0;
+        list<Entry> entries;                                    /* most recently used first */
+        unordered_map<string, list<Entry>::iterator> byKey;
+        mutable mutex lock;
+
+        atomic<uint64_t> hits{ 0 };
+        atomic<uint64_t> misses{ 0 };
+        atomic<uint64_t> evictions{ 0 };
+
+        static string keyFor(const string& operation, const string& params, uint64_t version);
+
+        /* Callers hold the lock */
+        void dropAll();
+        void evictDownTo(size_t limit);
+
+        shared_ptr<const void> find(const string& key, uint64_t version);
+        void insert(const string& key, uint64_t version, shared_ptr<const void> value, size_t bytes);
+
+    public:
+
+        explicit ResultCache(size_t budgetBytes = 64 << 20);
+
+        /* The cached result, or compute() stored under an estimated size of bytesOf(result).
+           A result bigger than the whole budget is returned without being kept. */
+        template<typename Compute, typename Bytes>
+        auto get(const string& operation, const string& params, uint64_t version, Compute&& compute, Bytes&& bytesOf)
+            -> shared_ptr<const decltype(compute())>;
+
+        /* Forget everything cached for data older than 'version' */
+        void invalidate(uint64_t version);
+        void clear();
+
+        void setBudget(size_t budgetBytes);
+
+        uint64_t getHits() const        { return hits; }
+        uint64_t getMisses() const      { return misses; }
+        uint64_t getEvictions() const   { return evictions; }
+        size_t getBytes() const;
+        size_t getEntries() const;
+
+        /* {"budgetBytes", "bytes", "entries", "evictions", "hits", "misses"} */
+        void writeStats(JsonWriter& writer) const;
+};
+
+template<typename Compute, typename Bytes>
+auto ResultCache::get(const string& operation, const string& params, uint64_t version, Compute&& compute, Bytes&& bytesOf)
+    -> shared_ptr<const decltype(compute())>
+{
+    using T = decltype(compute());
+
+    string key = keyFor(operation, params, version);
+    if (auto found = find(key, version))   { return static_pointer_cast<const T>(found); }
+
+    auto value = make_shared<const T>(compute());
+    insert(key, version, value, bytesOf(*value) + sizeof(Entry) + 2 * key.size());
+    return value;
+}
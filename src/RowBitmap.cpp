@@ -0,0 +1,288 @@
+#include "RowBitmap.h"
+#include <algorithm>
+#include <iterator>
+
+using namespace std;
+
+
+/* ---------------- Containers ---------------- */
+
+RowBitmap::Container& RowBitmap::containerFor(uint16_t key)
+{
+    /* Ascending inserts always land in the last container */
+    if (containers.empty() == false && containers.back().key == key)   { return containers.back(); }
+
+    auto it = lower_bound(containers.begin(), containers.end(), key,
+                          [](const Container& c, uint16_t k) { return c.key < k; });
+    if (it == containers.end() || it->key != key)
+    {
+        Container c;
+        c.key = key;
+        it = containers.insert(it, move(c));
+    }
+    return *it;
+}
+
+const RowBitmap::Container* RowBitmap::findContainer(uint16_t key) const
+{
+    auto it = lower_bound(containers.begin(), containers.end(), key,
+                          [](const Container& c, uint16_t k) { return c.key < k; });
+    return (it == containers.end() || it->key != key) ? nullptr : &*it;
+}
+
+void RowBitmap::toBitset(Container& c)
+{
+    c.words.assign(1024, 0);
+    for (uint16_t low : c.array)   { c.words[low >> 6] |= 1ULL << (low & 63); }
+    c.array.clear();
+    c.array.shrink_to_fit();
+}
+
+void RowBitmap::toArray(Container& c)
+{
+    c.array.clear();
+    c.array.reserve(c.cardinality);
+    for (uint32_t w = 0; w < c.words.size(); ++w)
+    {
+        uint64_t word = c.words[w];
+        while (word != 0)
+        {
+            c.array.push_back((uint16_t)(w * 64 + countr_zero(word)));
+            word &= word - 1;
+        }
+    }
+    c.words.clear();
+    c.words.shrink_to_fit();
+}
+
+RowBitmap::Container RowBitmap::intersect(const Container& a, const Container& b)
+{
+    Container out;
+    out.key = a.key;
+
+    if (a.isBitset() && b.isBitset())
+    {
+        /* Count first so a sparse result goes straight into an array */
+        for (size_t w = 0; w < 1024; ++w)   { out.cardinality += popcount(a.words[w] & b.words[w]); }
+
+        if (out.cardinality > ARRAY_LIMIT)
+        {
+            out.words.resize(1024);
+            for (size_t w = 0; w < 1024; ++w)   { out.words[w] = a.words[w] & b.words[w]; }
+        }
+        else
+        {
+            out.array.reserve(out.cardinality);
+            for (uint32_t w = 0; w < 1024; ++w)
+            {
+                uint64_t word = a.words[w] & b.words[w];
+                while (word != 0)
+                {
+                    out.array.push_back((uint16_t)(w * 64 + countr_zero(word)));
+                    word &= word - 1;
+                }
+            }
+        }
+    }
+    else if (a.isBitset() || b.isBitset())
+    {
+        const Container& bits = a.isBitset() ? a : b;
+        const Container& arr = a.isBitset() ? b : a;
+        for (uint16_t low : arr.array)
+        {
+            if (bits.words[low >> 6] & (1ULL << (low & 63)))   { out.array.push_back(low); }
+        }
+        out.cardinality = out.array.size();
+    }
+    else
+    {
+        set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), back_inserter(out.array));
+        out.cardinality = out.array.size();
+    }
+
+    return out;
+}
+
+RowBitmap::Container RowBitmap::unite(const Container& a, const Container& b)
+{
+    Container out;
+    out.key = a.key;
+
+    if (a.isBitset() || b.isBitset())
+    {
+        out.words = a.isBitset() ? a.words : b.words;
+        const Container& other = a.isBitset() ? b : a;
+        if (other.isBitset())
+        {
+            for (size_t w = 0; w < 1024; ++w)   { out.words[w] |= other.words[w]; }
+        }
+        else
+        {
+            for (uint16_t low : other.array)   { out.words[low >> 6] |= 1ULL << (low & 63); }
+        }
+        for (uint64_t word : out.words)   { out.cardinality += popcount(word); }
+    }
+    else
+    {
+        set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), back_inserter(out.array));
+        out.cardinality = out.array.size();
+        if (out.cardinality > ARRAY_LIMIT)   { toBitset(out); }
+    }
+
+    return out;
+}
+
+
+/* ---------------- RowBitmap ---------------- */
+
+void RowBitmap::add(uint32_t row)
+{
+    Container& c = containerFor((uint16_t)(row >> 16));
+    uint16_t low = (uint16_t)(row & 0xFFFF);
+
+    if (c.isBitset())
+    {
+        uint64_t& word = c.words[low >> 6];
+        uint64_t bit = 1ULL << (low & 63);
+        if ((word & bit) == 0)
+        {
+            word |= bit;
+            ++c.cardinality;
+        }
+        return;
+    }
+
+    if (c.array.empty() || c.array.back() < low)
+    {
+        c.array.push_back(low);
+    }
+    else
+    {
+        auto it = lower_bound(c.array.begin(), c.array.end(), low);
+        if (*it == low)   { return; }
+        c.array.insert(it, low);
+    }
+
+    if (++c.cardinality > ARRAY_LIMIT)   { toBitset(c); }
+}
+
+bool RowBitmap::contains(uint32_t row) const
+{
+    const Container* c = findContainer((uint16_t)(row >> 16));
+    if (c == nullptr)   { return false; }
+
+    uint16_t low = (uint16_t)(row & 0xFFFF);
+    if (c->isBitset())   { return (c->words[low >> 6] >> (low & 63)) & 1; }
+    return binary_search(c->array.begin(), c->array.end(), low);
+}
+
+uint64_t RowBitmap::cardinality() const
+{
+    uint64_t total = 0;
+    for (const auto& c : containers)   { total += c.cardinality; }
+    return total;
+}
+
+bool RowBitmap::empty() const   { return containers.empty(); }
+
+RowBitmap RowBitmap::operator&(const RowBitmap& other) const
+{
+    RowBitmap out;
+    size_t i = 0, j = 0;
+
+    while (i < containers.size() && j < other.containers.size())
+    {
+        if (containers[i].key < other.containers[j].key)        { ++i; }
+        else if (containers[i].key > other.containers[j].key)   { ++j; }
+        else
+        {
+            Container c = intersect(containers[i++], other.containers[j++]);
+            if (c.cardinality > 0)   { out.containers.push_back(move(c)); }
+        }
+    }
+
+    return out;
+}
+
+RowBitmap RowBitmap::operator|(const RowBitmap& other) const
+{
+    RowBitmap out;
+    size_t i = 0, j = 0;
+
+    while (i < containers.size() || j < other.containers.size())
+    {
+        if (j == other.containers.size()
+            || (i < containers.size() && containers[i].key < other.containers[j].key))
+        {
+            out.containers.push_back(containers[i++]);
+        }
+        else if (i == containers.size() || other.containers[j].key < containers[i].key)
+        {
+            out.containers.push_back(other.containers[j++]);
+        }
+        else
+        {
+            out.containers.push_back(unite(containers[i++], other.containers[j++]));
+        }
+    }
+
+    return out;
+}
+
+vector<uint32_t> RowBitmap::toRows() const
+{
+    vector<uint32_t> rows;
+    rows.reserve(cardinality());
+    forEach([&rows](uint32_t row) { rows.push_back(row); });
+    return rows;
+}
+
+vector<uint32_t> RowBitmap::toRows(uint64_t offset, uint64_t limit) const
+{
+    vector<uint32_t> rows;
+    for (const auto& c : containers)
+    {
+        if (rows.size() >= limit)   { break; }
+        if (offset >= c.cardinality)
+        {
+            offset -= c.cardinality;
+            continue;
+        }
+
+        uint32_t high = (uint32_t)c.key << 16;
+        if (c.isBitset() == false)
+        {
+            for (size_t i = offset; i < c.array.size() && rows.size() < limit; ++i)   { rows.push_back(high | c.array[i]); }
+            offset = 0;
+            continue;
+        }
+
+        for (uint32_t w = 0; w < c.words.size() && rows.size() < limit; ++w)
+        {
+            uint64_t word = c.words[w];
+            uint64_t bits = (uint64_t)popcount(word);
+            if (offset >= bits)
+            {
+                offset -= bits;
+                continue;
+            }
+            for (; offset > 0; --offset)   { word &= word - 1; }
+            while (word != 0 && rows.size() < limit)
+            {
+                rows.push_back(high | (w * 64 + (uint32_t)countr_zero(word)));
+                word &= word - 1;
+            }
+        }
+    }
+    return rows;
+}
+
+size_t RowBitmap::memoryBytes() const
+{
+    size_t bytes = sizeof(RowBitmap) + containers.capacity() * sizeof(Container);
+    for (const auto& c : containers)
+    {
+        bytes += c.array.capacity() * sizeof(uint16_t) + c.words.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
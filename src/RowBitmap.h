@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+
+using namespace std;
+
+/* Compressed set of row ids in the Roaring layout: ids are split by their high 16 bits into containers, and
+   each container stores its low 16 bits as a sorted array while it holds at most 4096 of them, or as a
+   65536-bit set once it holds more. AND/OR work container by container, so their cost depends on how
+   many containers the operands have, not on how many rows they match. */
+class RowBitmap
+{
+    private:
+
+        struct Container
+        {
+            uint16_t key = 0;                /* high 16 bits shared by every id in the container */
+            uint32_t cardinality = 0;
+            vector<uint16_t> array;          /* sorted low bits, used while cardinality <= ARRAY_LIMIT */
+            vector<uint64_t> words;          /* 1024-word bitset, used above it (empty otherwise) */
+
+            bool isBitset() const   { return words.empty() == false; }
+        };
+
+        static const uint32_t ARRAY_LIMIT = 4096;
+
+        /* Containers sorted by key */
+        vector<Container> containers;
+
+        Container& containerFor(uint16_t key);
+        const Container* findContainer(uint16_t key) const;
+
+        static void toBitset(Container& c);
+        static void toArray(Container& c);
+        static Container intersect(const Container& a, const Container& b);
+        static Container unite(const Container& a, const Container& b);
+
+    public:
+
+        /* Add a row id; adding ids in ascending order (as index builds do) takes the fast path */
+        void add(uint32_t row);
+        bool contains(uint32_t row) const;
+
+        uint64_t cardinality() const;
+        bool empty() const;
+
+        RowBitmap operator&(const RowBitmap& other) const;
+        RowBitmap operator|(const RowBitmap& other) const;
+
+        /* Every row id in ascending order */
+        vector<uint32_t> toRows() const;
+
+        /* The row ids at positions [offset, offset + limit) of the ascending order, fewer near the end. Whole
+           containers are skipped by their cardinality and bitset words by their popcount, so a page costs
+           O(containers + limit) however far into the bitmap it starts. */
+        vector<uint32_t> toRows(uint64_t offset, uint64_t limit) const;
+
+        /* Call f(row) for every row id in ascending order */
+        template<typename F>
+        void forEach(F&& f) const;
+
+        size_t memoryBytes() const;
+};
+
+template<typename F>
+void RowBitmap::forEach(F&& f) const
+{
+    for (const auto& c : containers)
+    {
+        uint32_t high = (uint32_t)c.key << 16;
+        if (c.isBitset())
+        {
+            for (uint32_t w = 0; w < c.words.size(); ++w)
+            {
+                uint64_t word = c.words[w];
+                while (word != 0)
+                {
+                    f(high | (w * 64 + (uint32_t)countr_zero(word)));
+                    word &= word - 1;
+                }
+            }
+        }
+        else
+        {
+            for (uint16_t low : c.array)   { f(high | low); }
+        }
+    }
+}
@@ -0,0 +1,346 @@
+#include "Synthetic.h"
+#include "Dates.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <stdexcept>
+
+using namespace std;
+
+
+/* Day number of a lastLogin, which fitting requires to be a date */
+static int parseLoginDay(const string& date)
+{
+    int32_t day = parseDay(string_view(date).substr(0, 10));
+    if (day == NO_DAY)   { throw invalid_argument("Not a YYYY-MM-DD date: " + date); }
+    return day;
+}
+
+
+/* ---------------- Profile ---------------- */
+
+SyntheticProfile SyntheticProfile::fit(const vector<User>& sample, unsigned int quantiles)
+{
+    if (sample.empty())   { throw invalid_argument("Cannot fit a profile to no users!"); }
+    quantiles = max(1u, quantiles);
+
+    auto frequencies = [](const map<string, double>& counts) {
+        vector<Weighted> weighted;
+        for (const auto& [value, count] : counts)   { weighted.push_back({ value, count }); }
+        return weighted;
+    };
+
+    map<string, double> countries, subscriptions, genres, firstNames, lastNames;
+    map<int, double> ages, days;
+    vector<double> watchTimes;
+    watchTimes.reserve(sample.size());
+
+    for (const auto& user : sample)
+    {
+        ++countries[user.country];
+        ++subscriptions[user.subscription];
+        ++genres[user.genre];
+
+        size_t space = user.name.find(' ');
+        ++firstNames[user.name.substr(0, space)];
+        ++lastNames[space == string::npos ? "" : user.name.substr(space + 1)];
+
+        ++ages[user.age];
+        ++days[parseLoginDay(user.lastLogin)];
+        watchTimes.push_back(user.watchTime);
+    }
+
+    SyntheticProfile profile;
+    profile.countries = frequencies(countries);
+    profile.subscriptions = frequencies(subscriptions);
+    profile.genres = frequencies(genres);
+    profile.firstNames = frequencies(firstNames);
+    profile.lastNames = frequencies(lastNames);
+
+    profile.minAge = ages.begin()->first;
+    profile.ageWeights.assign(ages.rbegin()->first - profile.minAge + 1, 0.0);
+    for (const auto& [age, count] : ages)   { profile.ageWeights[age - profile.minAge] = count; }
+
+    profile.firstLoginDay = days.begin()->first;
+    profile.loginDayWeights.assign(days.rbegin()->first - profile.firstLoginDay + 1, 0.0);
+    for (const auto& [day, count] : days)   { profile.loginDayWeights[day - profile.firstLoginDay] = count; }
+
+    sort(watchTimes.begin(), watchTimes.end());
+    for (unsigned int q = 0; q <= quantiles; ++q)
+    {
+        double position = (double)q / quantiles * (watchTimes.size() - 1);
+        size_t below = (size_t)position;
+        size_t above = min(below + 1, watchTimes.size() - 1);
+        profile.watchTimeQuantiles.push_back(watchTimes[below] + (watchTimes[above] - watchTimes[below]) * (position - below));
+    }
+
+    return profile;
+}
+
+SyntheticProfile SyntheticProfile::netflixUsers()
+{
+    SyntheticProfile profile;
+
+    profile.countries = { { "Australia", 2437 }, { "Brazil", 2503 }, { "Canada", 2490 }, { "France", 2473 },
+                          { "Germany", 2547 }, { "India", 2505 }, { "Japan", 2457 }, { "Mexico", 2493 },
+                          { "UK", 2592 }, { "USA", 2503 } };
+    profile.subscriptions = { { "Basic", 8356 }, { "Premium", 8402 }, { "Standard", 8242 } };
+    profile.genres = { { "Action", 3589 }, { "Comedy", 3561 }, { "Documentary", 3636 }, { "Drama", 3533 },
+                       { "Horror", 3654 }, { "Romance", 3572 }, { "Sci-Fi", 3455 } };
+    profile.firstNames = { { "Alex", 2543 }, { "Chris", 2380 }, { "David", 2470 }, { "Emma", 2516 }, { "James", 2465 },
+                           { "Jane", 2500 }, { "John", 2514 }, { "Katie", 2507 }, { "Michael", 2582 }, { "Sarah", 2523 } };
+    profile.lastNames = { { "Brown", 2515 }, { "Davis", 2381 }, { "Garcia", 2506 }, { "Hernandez", 2512 },
+                          { "Johnson", 2480 }, { "Jones", 2576 }, { "Martinez", 2486 }, { "Miller", 2495 },
+                          { "Smith", 2497 }, { "Williams", 2552 } };
+
+    /* Ages 13 to 80 */
+    profile.minAge = 13;
+    profile.ageWeights = { 339, 374, 359, 373, 368, 375, 357, 380, 354, 368, 371, 372, 374, 407, 368, 378, 376,
+                           372, 376, 341, 359, 344, 356, 326, 356, 366, 385, 406, 353, 383, 353, 371, 405, 386,
+                           386, 376, 370, 360, 338, 362, 349, 345, 377, 381, 404, 366, 361, 370, 377, 400, 372,
+                           353, 349, 361, 389, 375, 351, 361, 367, 374, 334, 330, 365, 354, 378, 371, 378, 385 };
+
+    /* Every 5%: the file's watch times are spread evenly over 0.12 to 999.99 hours */
+    profile.watchTimeQuantiles = { 0.12, 52.32, 101.51, 153.96, 205.54, 256.57, 304.56, 354.07, 403.09, 451.72, 501.5,
+                                   547.49, 598.95, 647.67, 697.16, 745.73, 794.99, 846.71, 897.6, 950.15, 999.99 };
+
+    /* Logins spread evenly over the year 2024-03-08 to 2025-03-08 */
+    profile.firstLoginDay = daysFromCivil(2024, 3, 8);
+    profile.loginDayWeights.assign(daysFromCivil(2025, 3, 8) - profile.firstLoginDay + 1, 1.0);
+
+    return profile;
+}
+
+
+/* ---------------- Generator ---------------- */
+
+SyntheticUsers::Discrete::Discrete(const vector<double>& weights)
+{
+    double total = 0.0;
+    for (double w : weights)
+    {
+        if (w < 0.0)   { throw invalid_argument("Negative weight in a synthetic profile!"); }
+        total += w;
+        cumulative.push_back(total);
+    }
+    if (total <= 0.0)   { throw invalid_argument("A synthetic profile distribution has no weight!"); }
+
+    for (double& c : cumulative)   { c /= total; }
+}
+
+size_t SyntheticUsers::Discrete::sample(double u) const
+{
+    size_t i = upper_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin();
+    return min(i, cumulative.size() - 1);
+}
+
+static vector<double> weightsOf(const vector<SyntheticProfile::Weighted>& values)
+{
+    vector<double> weights;
+    for (const auto& v : values)   { weights.push_back(v.weight); }
+    return weights;
+}
+
+SyntheticUsers::SyntheticUsers(SyntheticProfile profile, uint64_t seed) : profile(move(profile)), seed(seed)
+{
+    const SyntheticProfile& p = this->profile;
+    if (p.watchTimeQuantiles.empty())   { throw invalid_argument("A synthetic profile needs watch-time quantiles!"); }
+
+    countries = Discrete(weightsOf(p.countries));
+    subscriptions = Discrete(weightsOf(p.subscriptions));
+    genres = Discrete(weightsOf(p.genres));
+    firstNames = Discrete(weightsOf(p.firstNames));
+    lastNames = Discrete(weightsOf(p.lastNames));
+    ages = Discrete(p.ageWeights);
+    loginDays = Discrete(p.loginDayWeights);
+
+    for (size_t d = 0; d < p.loginDayWeights.size(); ++d)   { loginDates.push_back(civilFromDays(p.firstLoginDay + (int)d)); }
+}
+
+double SyntheticUsers::uniform(uint64_t row, Field field) const
+{
+    /* SplitMix64's output function applied to a counter: a strong enough mix for sampling, and stateless */
+    uint64_t z = seed + (row * FIELDS + field + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return (z >> 11) * 0x1.0p-53;
+}
+
+SyntheticUsers::Draw SyntheticUsers::draw(uint64_t row) const
+{
+    Draw d;
+    d.country = countries.sample(uniform(row, Country));
+    d.subscription = subscriptions.sample(uniform(row, Subscription));
+    d.genre = genres.sample(uniform(row, Genre));
+    d.firstName = firstNames.sample(uniform(row, FirstName));
+    d.lastName = lastNames.sample(uniform(row, LastName));
+    d.loginDay = loginDays.sample(uniform(row, LoginDay));
+    d.age = profile.minAge + (int)ages.sample(uniform(row, Age));
+
+    const vector<double>& q = profile.watchTimeQuantiles;
+    double position = uniform(row, WatchTime) * (q.size() - 1);
+    size_t below = (size_t)position;
+    size_t above = min(below + 1, q.size() - 1);
+    d.watchTime = round((q[below] + (q[above] - q[below]) * (position - below)) * 100.0) / 100.0;
+
+    return d;
+}
+
+User SyntheticUsers::user(uint64_t row) const
+{
+    Draw d = draw(row);
+
+    User user;
+    user.userID = (int)(row + 1);
+    user.name = profile.firstNames[d.firstName].value + " " + profile.lastNames[d.lastName].value;
+    user.age = d.age;
+    user.country = profile.countries[d.country].value;
+    user.subscription = profile.subscriptions[d.subscription].value;
+    user.watchTime = d.watchTime;
+    user.genre = profile.genres[d.genre].value;
+    user.lastLogin = loginDates[d.loginDay];
+    return user;
+}
+
+vector<User> SyntheticUsers::generate(size_t n, ThreadPool& pool) const
+{
+    vector<User> users(n);
+    parallelFor(0, n, 65536, [&](size_t lo, size_t hi) {
+        for (size_t row = lo; row < hi; ++row)   { users[row] = user(row); }
+    }, pool);
+    return users;
+}
+
+UserTable SyntheticUsers::table(size_t n, ThreadPool& pool) const
+{
+    /* Login months, indexed like the months of the login days */
+    vector<string> months;
+    vector<uint16_t> monthOfDay;
+    for (const string& date : loginDates)
+    {
+        string month = date.substr(0, 7);
+        if (months.empty() || months.back() != month)   { months.push_back(month); }
+        monthOfDay.push_back((uint16_t)(months.size() - 1));
+    }
+
+    UserTable table;
+    table.countryCodes.resize(n);
+    table.subscriptionCodes.resize(n);
+    table.genreCodes.resize(n);
+    table.loginMonthCodes.resize(n);
+    table.userIDs.resize(n);
+    table.ages.resize(n);
+    table.watchTimes.resize(n);
+    table.loginDays.resize(n);
+
+    /* Fill the columns with profile indexes first ... */
+    parallelFor(0, n, 65536, [&](size_t lo, size_t hi) {
+        for (size_t row = lo; row < hi; ++row)
+        {
+            Draw d = draw(row);
+            table.countryCodes[row] = (uint16_t)d.country;
+            table.subscriptionCodes[row] = (uint16_t)d.subscription;
+            table.genreCodes[row] = (uint16_t)d.genre;
+            table.loginMonthCodes[row] = monthOfDay[d.loginDay];
+            table.userIDs[row] = (int)(row + 1);
+            table.ages[row] = d.age;
+            table.watchTimes[row] = d.watchTime;
+            table.loginDays[row] = profile.firstLoginDay + (int32_t)d.loginDay;
+        }
+    }, pool);
+
+    /* ... then renumber them in order of first appearance, as buildUserTable's dictionaries would. Every value
+       has usually turned up within the first few rows, so the sequential search for them ends early. */
+    auto encode = [&](vector<uint16_t>& codes, Dictionary& dictionary, const function<const string&(size_t)>& valueOf,
+                      size_t values)
+    {
+        vector<uint16_t> remap(values, 0);
+        vector<bool> seen(values, false);
+        size_t found = 0;
+        for (size_t row = 0; row < n && found < values; ++row)
+        {
+            uint16_t index = codes[row];
+            if (seen[index])   { continue; }
+
+            seen[index] = true;
+            remap[index] = dictionary.encode(valueOf(index));
+            ++found;
+        }
+
+        parallelFor(0, n, 1 << 20, [&](size_t lo, size_t hi) {
+            for (size_t row = lo; row < hi; ++row)   { codes[row] = remap[codes[row]]; }
+        }, pool);
+    };
+
+    const SyntheticProfile& p = profile;
+    encode(table.countryCodes, table.countries, [&p](size_t i) -> const string& { return p.countries[i].value; }, p.countries.size());
+    encode(table.subscriptionCodes, table.subscriptions, [&p](size_t i) -> const string& { return p.subscriptions[i].value; }, p.subscriptions.size());
+    encode(table.genreCodes, table.genres, [&p](size_t i) -> const string& { return p.genres[i].value; }, p.genres.size());
+    encode(table.loginMonthCodes, table.loginMonths, [&months](size_t i) -> const string& { return months[i]; }, months.size());
+
+    for (int age : table.ages)   { table.maxAge = max(table.maxAge, age); }
+    for (int32_t day : table.loginDays)
+    {
+        table.firstLoginDay = table.firstLoginDay == NO_DAY ? day : min(table.firstLoginDay, day);
+        table.lastLoginDay = max(table.lastLoginDay, day);
+    }
+
+    return table;
+}
+
+bool SyntheticUsers::writeCsv(ostream& out, size_t n, ThreadPool& pool) const
+{
+    const size_t BLOCK_ROWS = 32768;
+    size_t blocksPerBatch = 2 * pool.getThreadCount();
+
+    auto formatBlock = [this](size_t lo, size_t hi, string& text) {
+        text.clear();
+        char number[32];
+        for (size_t row = lo; row < hi; ++row)
+        {
+            Draw d = draw(row);
+
+            text.append(number, to_chars(number, number + sizeof(number), row + 1).ptr);
+            text += ',';
+            text += profile.firstNames[d.firstName].value;
+            text += ' ';
+            text += profile.lastNames[d.lastName].value;
+            text += ',';
+            text.append(number, to_chars(number, number + sizeof(number), d.age).ptr);
+            text += ',';
+            text += profile.countries[d.country].value;
+            text += ',';
+            text += profile.subscriptions[d.subscription].value;
+            text += ',';
+            text.append(number, to_chars(number, number + sizeof(number), d.watchTime, chars_format::fixed, 2).ptr);
+            text += ',';
+            text += profile.genres[d.genre].value;
+            text += ',';
+            text += loginDates[d.loginDay];
+            text += '\n';
+        }
+    };
+
+    out << "User_ID,Name,Age,Country,Subscription_Type,Watch_Time_Hours,Favorite_Genre,Last_Login\n";
+
+    /* Format a batch of blocks in parallel, write it in order, and reuse the buffers for the next batch */
+    vector<string> blocks(blocksPerBatch);
+    for (size_t batchStart = 0; batchStart < n && out; batchStart += blocksPerBatch * BLOCK_ROWS)
+    {
+        size_t batchEnd = min(n, batchStart + blocksPerBatch * BLOCK_ROWS);
+        size_t count = (batchEnd - batchStart + BLOCK_ROWS - 1) / BLOCK_ROWS;
+
+        parallelFor(0, count, 1, [&](size_t b, size_t) {
+            size_t lo = batchStart + b * BLOCK_ROWS;
+            formatBlock(lo, min(batchEnd, lo + BLOCK_ROWS), blocks[b]);
+        }, pool);
+
+        for (size_t b = 0; b < count; ++b)   { out.write(blocks[b].data(), blocks[b].size()); }
+    }
+
+    out.flush();
+    return (bool)out;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "User.h"
+#include "UserTable.h"
+#include "ThreadPool.h"
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+
+using namespace std;
+
+/* Synthetic users at any scale for benchmarking, drawn from distributions fitted to a real sample */
+
+/* ---------------- Profile ---------------- */
+/* The distributions users are drawn from. Weights need not sum to one. */
+struct SyntheticProfile
+{
+    struct Weighted
+    {
+        string value;
+        double weight;
+    };
+
+    vector<Weighted> countries;
+    vector<Weighted> subscriptions;
+    vector<Weighted> genres;
+    vector<Weighted> firstNames;
+    vector<Weighted> lastNames;
+
+    int minAge = 0;
+    vector<double> ageWeights;          /* weight of age minAge + i */
+
+    /* Watch time at evenly spaced quantiles, first the minimum and last the maximum; a draw interpolates
+       linearly between the two quantiles around it, so the fit keeps whatever shape the sample has */
+    vector<double> watchTimeQuantiles;
+
+    int firstLoginDay = 0;              /* days since 1970-01-01 */
+    vector<double> loginDayWeights;     /* weight of firstLoginDay + i */
+
+    /* The distributions of 'sample': frequencies of every value, the age and login-day histograms and
+       'quantiles' + 1 watch-time quantiles. Throws invalid_argument for an empty sample or a lastLogin
+       that is not a YYYY-MM-DD date. */
+    static SyntheticProfile fit(const vector<User>& sample, unsigned int quantiles = 100);
+
+    /* Fitted to data/netflix_users.csv (25,000 users) */
+    static SyntheticProfile netflixUsers();
+};
+
+/* ---------------- Generator ---------------- */
+/* User 'row' (userID row + 1) depends only on the seed and the row: every field is drawn from a counter-based
+   random stream keyed by (seed, row, field), so any range of rows can be generated on its own, in any order and
+   on any number of threads, and the same seed always gives the same users. */
+class SyntheticUsers
+{
+    private:
+
+        /* Inverse CDF of a discrete distribution: the index whose cumulative weight first passes u in [0, 1) */
+        struct Discrete
+        {
+            vector<double> cumulative;
+
+            Discrete() = default;
+            explicit Discrete(const vector<double>& weights);
+            size_t sample(double u) const;
+        };
+
+        SyntheticProfile profile;
+        uint64_t seed;
+        Discrete countries, subscriptions, genres, firstNames, lastNames, ages, loginDays;
+        vector<string> loginDates;          /* "YYYY-MM-DD" of every login day */
+
+        enum Field { Country, Subscription, Genre, FirstName, LastName, Age, WatchTime, LoginDay, FIELDS };
+
+        double uniform(uint64_t row, Field field) const;
+
+        /* The profile index of each field of a row */
+        struct Draw
+        {
+            size_t country, subscription, genre, firstName, lastName, loginDay;
+            int age;
+            double watchTime;                   /* rounded to hundredths of an hour */
+        };
+        Draw draw(uint64_t row) const;
+
+    public:
+
+        SyntheticUsers(SyntheticProfile profile, uint64_t seed);
+
+        User user(uint64_t row) const;
+
+        /* Users 0 .. n-1, generated in parallel on 'pool' */
+        vector<User> generate(size_t n, ThreadPool& pool = ThreadPool::shared()) const;
+
+        /* The table buildUserTable(generate(n)) would give, filled in place without the users in between */
+        UserTable table(size_t n, ThreadPool& pool = ThreadPool::shared()) const;
+
+        /* Users 0 .. n-1 as netflix_users.csv lines after its header, formatted in parallel a batch of blocks at a
+           time, so memory stays a few MB per thread however large n is. Returns false if the stream fails. */
+        bool writeCsv(ostream& out, size_t n, ThreadPool& pool = ThreadPool::shared()) const;
+};
@@ -0,0 +1,194 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+
+using namespace std;
+
+
+/* The pool and worker the current thread belongs to; set once at the start of every worker thread */
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local size_t currentIndex = 0;
+
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount == 0)   { threadCount = max(1u, thread::hardware_concurrency()); }
+    this->threadCount = threadCount;
+
+    for (unsigned int i = 0; i < threadCount; ++i)   { queues.push_back(make_unique<Queue>()); }
+    for (unsigned int i = 0; i + 1 < threadCount; ++i)   { workers.emplace_back(&ThreadPool::work, this, i); }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers)   { worker.join(); }
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+size_t ThreadPool::ownIndex() const
+{
+    /* The injection queue is the last one */
+    return currentPool == this ? currentIndex : queues.size() - 1;
+}
+
+void ThreadPool::submit(function<void()> task)
+{
+    Queue& queue = *queues[ownIndex()];
+    {
+        lock_guard<mutex> guard(queue.lock);
+        queue.tasks.push_back(move(task));
+        ++queued;
+    }
+
+    /* Taking the lock orders this against a worker checking 'queued' just before it sleeps */
+    {
+        lock_guard<mutex> guard(sleepLock);
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::popOwn(size_t index, function<void()>& task)
+{
+    Queue& queue = *queues[index];
+    lock_guard<mutex> guard(queue.lock);
+    if (queue.tasks.empty())   { return false; }
+
+    /* Workers run their newest task first, while its data is still in cache; the injection queue is FIFO */
+    bool worker = index + 1 < queues.size();
+    task = move(worker ? queue.tasks.back() : queue.tasks.front());
+    if (worker)   { queue.tasks.pop_back(); }
+    else          { queue.tasks.pop_front(); }
+    --queued;
+    return true;
+}
+
+bool ThreadPool::steal(size_t thief, function<void()>& task)
+{
+    bool worker = thief + 1 < queues.size();
+
+    for (size_t offset = 1; offset < queues.size(); ++offset)
+    {
+        size_t victim = (thief + offset) % queues.size();
+
+        /* A worker takes the older half of the victim's tasks; an outside thread only the one it will run */
+        vector<function<void()>> taken;
+        {
+            Queue& queue = *queues[victim];
+            lock_guard<mutex> guard(queue.lock);
+            if (queue.tasks.empty())   { continue; }
+
+            size_t count = worker ? (queue.tasks.size() + 1) / 2 : 1;
+            for (size_t i = 0; i < count; ++i)
+            {
+                taken.push_back(move(queue.tasks.front()));
+                queue.tasks.pop_front();
+            }
+            --queued;
+        }
+        ++steals;
+
+        task = move(taken.front());
+        if (taken.size() > 1)
+        {
+            Queue& own = *queues[thief];
+            lock_guard<mutex> guard(own.lock);
+            for (size_t i = 1; i < taken.size(); ++i)   { own.tasks.push_back(move(taken[i])); }
+        }
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::findTask(size_t index, function<void()>& task)
+{
+    return popOwn(index, task) || steal(index, task);
+}
+
+bool ThreadPool::runOne()
+{
+    function<void()> task;
+    if (findTask(ownIndex(), task) == false)   { return false; }
+
+    task();
+    return true;
+}
+
+void ThreadPool::work(size_t index)
+{
+    currentPool = this;
+    currentIndex = index;
+    Trace::setThreadName("pool worker " + to_string(index + 1));
+
+    while (true)
+    {
+        function<void()> task;
+        if (findTask(index, task))
+        {
+            task();
+            continue;
+        }
+
+        unique_lock<mutex> guard(sleepLock);
+        wake.wait(guard, [this]() { return stopping || queued > 0; });
+        if (stopping && queued == 0)   { return; }
+    }
+}
+
+
+/* ---------------- Task Group ---------------- */
+
+TaskGroup::TaskGroup(ThreadPool& pool) : pool(pool) {}
+
+TaskGroup::~TaskGroup()
+{
+    try
+    {
+        wait();
+    }
+    catch (...)
+    {
+    }
+}
+
+void TaskGroup::run(function<void()> task)
+{
+    ++pending;
+    pool.submit([this, task = move(task)]() {
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            lock_guard<mutex> guard(errorLock);
+            if (!error)   { error = current_exception(); }
+        }
+        --pending;
+    });
+}
+
+void TaskGroup::wait()
+{
+    /* Help rather than sleep: the tasks still pending are queued somewhere in the pool or already running */
+    while (pending > 0)
+    {
+        if (pool.runOne() == false)   { this_thread::yield(); }
+    }
+
+    lock_guard<mutex> guard(errorLock);
+    if (error)
+    {
+        exception_ptr thrown = error;
+        error = nullptr;
+        rethrow_exception(thrown);
+    }
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+/* ---------------- Thread Pool ---------------- */
+/* A work-stealing task scheduler. Every background worker owns a deque: it pushes and pops its own tasks at
+   the back, most recent first, and when it runs dry it steals the older half of another worker's deque from
+   the front, so one steal spreads a burst of tasks instead of taking them one at a time. Tasks submitted from
+   outside the pool go to a shared injection queue that workers steal from the same way.
+   threadCount counts the thread that waits for the work: a pool of N threads runs N - 1 workers, and whoever
+   waits on a TaskGroup runs tasks too until the group is done. So a waiting task never blocks a worker, and
+   nested parallel loops cannot deadlock. */
+class ThreadPool
+{
+    private:
+
+        struct Queue
+        {
+            mutex lock;
+            deque<function<void()>> tasks;
+        };
+
+        unsigned int threadCount;
+        vector<unique_ptr<Queue>> queues;       /* one per worker, then the injection queue */
+        vector<thread> workers;
+
+        mutex sleepLock;
+        condition_variable wake;
+        atomic<size_t> queued{ 0 };
+        atomic<bool> stopping{ false };
+        atomic<uint64_t> steals{ 0 };
+
+        /* The worker the current thread is, if it is one of this pool's */
+        size_t ownIndex() const;
+
+        bool popOwn(size_t index, function<void()>& task);
+        bool steal(size_t thief, function<void()>& task);
+        bool findTask(size_t index, function<void()>& task);
+        void work(size_t index);
+
+    public:
+
+        /* threadCount 0 uses every hardware thread */
+        explicit ThreadPool(unsigned int threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /* Queue a task; a worker queues on its own deque, any other thread on the injection queue */
+        void submit(function<void()> task);
+
+        /* Run one queued task on the calling thread; false when none could be found */
+        bool runOne();
+
+        unsigned int getThreadCount() const   { return threadCount; }
+        uint64_t getSteals() const            { return steals; }
+
+        /* The pool every analysis runs on, sized to the hardware threads and started on first use */
+        static ThreadPool& shared();
+};
+
+/* ---------------- Task Group ---------------- */
+/* Tasks run on a pool and waited for together. wait() runs queued tasks while it waits and rethrows the first
+   exception any of the group's tasks threw; the rest of the group still runs to the end. */
+class TaskGroup
+{
+    private:
+
+        ThreadPool& pool;
+        atomic<size_t> pending{ 0 };
+        mutex errorLock;
+        exception_ptr error;
+
+    public:
+
+        explicit TaskGroup(ThreadPool& pool = ThreadPool::shared());
+        ~TaskGroup();                           /* waits, dropping any exception */
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        void run(function<void()> task);
+        void wait();
+};
+
+/* ---------------- Parallel Loops ---------------- */
+
+/* body(lo, hi) over [begin, end) in chunks of 'grain' items (the last one shorter), run as tasks on 'pool'.
+   The chunk bounds depend only on the range and the grain, never on the number of threads. */
+template<typename Body>
+void parallelFor(size_t begin, size_t end, size_t grain, Body&& body, ThreadPool& pool = ThreadPool::shared())
+{
+    if (begin >= end)   { return; }
+    grain = max<size_t>(grain, 1);
+
+    if (end - begin <= grain || pool.getThreadCount() == 1)
+    {
+        for (size_t lo = begin; lo < end; lo += min(grain, end - lo))   { body(lo, lo + min(grain, end - lo)); }
+        return;
+    }
+
+    TaskGroup group(pool);
+    for (size_t lo = begin; lo < end; lo += min(grain, end - lo))
+    {
+        size_t hi = lo + min(grain, end - lo);
+        group.run([&body, lo, hi]() { body(lo, hi); });
+    }
+    group.wait();
+}
+
+/* Reduce [begin, end): map(lo, hi) turns each chunk of 'grain' items into a T, and combine(total, part) folds
+   the parts into 'identity' in chunk order on the calling thread, so the result is the same on any number of
+   threads even when combine is not associative, as with floating-point sums. */
+template<typename T, typename Map, typename Combine>
+T parallelReduce(size_t begin, size_t end, size_t grain, T identity, Map&& map, Combine&& combine,
+                 ThreadPool& pool = ThreadPool::shared())
+{
+    if (begin >= end)   { return identity; }
+    grain = max<size_t>(grain, 1);
+
+    size_t chunks = (end - begin + grain - 1) / grain;
+    vector<T> parts(chunks, identity);
+    parallelFor(0, chunks, 1, [&](size_t lo, size_t hi) {
+        for (size_t c = lo; c < hi; ++c)
+        {
+            size_t from = begin + c * grain;
+            parts[c] = map(from, min(end, from + grain));
+        }
+    }, pool);
+
+    T total = move(identity);
+    for (auto& part : parts)   { combine(total, move(part)); }
+    return total;
+}
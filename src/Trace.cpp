@@ -0,0 +1,205 @@
+#include "Trace.h"
+#include "JsonWriter.h"
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+
+/* Events per thread before the oldest are overwritten: 2 MB of buffer */
+static const size_t RING_CAPACITY = 1 << 16;
+
+struct TraceEvent
+{
+    const char* name;
+    int64_t startNs;
+    int64_t durationNs;
+    uint64_t bytes;
+};
+
+/* One thread's events. Only the owning thread writes; 'head' counts every event ever recorded. */
+struct TraceRing
+{
+    uint64_t id;
+    string threadName;                  /* guarded by the registry lock */
+    atomic<uint64_t> head{ 0 };
+    vector<TraceEvent> events = vector<TraceEvent>(RING_CAPACITY);
+};
+
+/* Every thread's ring, kept after the thread exits so its events can still be dumped */
+static mutex registryLock;
+static vector<shared_ptr<TraceRing>> rings;
+
+static thread_local TraceRing* ownRing = nullptr;
+static thread_local string ownName;
+
+static TraceRing& threadRing()
+{
+    if (ownRing == nullptr)
+    {
+        auto ring = make_shared<TraceRing>();
+        lock_guard<mutex> guard(registryLock);
+        ring->id = rings.size() + 1;
+        ring->threadName = ownName;
+        rings.push_back(ring);
+        ownRing = ring.get();
+    }
+    return *ownRing;
+}
+
+
+int64_t Trace::now()
+{
+    static const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+}
+
+void Trace::record(const char* name, int64_t startNs, int64_t durationNs, uint64_t bytes)
+{
+    TraceRing& ring = threadRing();
+    uint64_t head = ring.head.load(memory_order_relaxed);
+    ring.events[head % RING_CAPACITY] = { name, startNs, durationNs, bytes };
+    ring.head.store(head + 1, memory_order_release);
+}
+
+void Trace::setThreadName(const string& name)
+{
+    ownName = name;
+
+    lock_guard<mutex> guard(registryLock);
+    if (ownRing)   { ownRing->threadName = name; }
+}
+
+void Trace::clear()
+{
+    lock_guard<mutex> guard(registryLock);
+    for (auto& ring : rings)   { ring->head.store(0, memory_order_release); }
+}
+
+uint64_t Trace::getDropped()
+{
+    lock_guard<mutex> guard(registryLock);
+    uint64_t dropped = 0;
+    for (auto& ring : rings)
+    {
+        uint64_t head = ring->head.load(memory_order_acquire);
+        if (head > RING_CAPACITY)   { dropped += head - RING_CAPACITY; }
+    }
+    return dropped;
+}
+
+/* Call f(ring, event) for every event still held, oldest first per thread; callers hold the registry lock */
+template<typename F>
+static void forEachEvent(F&& f)
+{
+    for (auto& ring : rings)
+    {
+        uint64_t head = ring->head.load(memory_order_acquire);
+        for (uint64_t i = head > RING_CAPACITY ? head - RING_CAPACITY : 0; i < head; ++i)
+           { f(*ring, ring->events[i % RING_CAPACITY]); }
+    }
+}
+
+void Trace::writeChromeTrace(ostream& out)
+{
+    lock_guard<mutex> guard(registryLock);
+    JsonWriter writer(out, ExportFormat::CompactJson);
+
+    writer.beginObject();
+    writer.member("displayTimeUnit", "ms");
+    writer.key("traceEvents");
+    writer.beginArray();
+
+    for (auto& ring : rings)
+    {
+        if (ring->threadName.empty())   { continue; }
+
+        writer.beginObject();
+        writer.key("args");
+        writer.beginObject();
+        writer.member("name", ring->threadName);
+        writer.endObject();
+        writer.member("name", "thread_name");
+        writer.member("ph", "M");
+        writer.member("pid", 1);
+        writer.member("tid", ring->id);
+        writer.endObject();
+    }
+
+    forEachEvent([&](const TraceRing& ring, const TraceEvent& event) {
+        writer.beginObject();
+        writer.key("args");
+        writer.beginObject();
+        writer.member("bytes", event.bytes);
+        writer.endObject();
+        writer.member("cat", "flixhabit");
+        writer.member("dur", event.durationNs / 1000.0);
+        writer.member("name", event.name);
+        writer.member("ph", "X");
+        writer.member("pid", 1);
+        writer.member("tid", ring.id);
+        writer.member("ts", event.startNs / 1000.0);
+        writer.endObject();
+    });
+
+    writer.endArray();
+    writer.endObject();
+    writer.flush();
+    out << "\n";
+}
+
+void Trace::writeSummary(ostream& out)
+{
+    struct Phase
+    {
+        string name;
+        uint64_t count = 0;
+        int64_t totalNs = 0;
+        int64_t maxNs = 0;
+        uint64_t bytes = 0;
+    };
+
+    /* Names are compared by content: the same literal may have several addresses across translation units */
+    map<string, Phase> phases;
+    {
+        lock_guard<mutex> guard(registryLock);
+        forEachEvent([&](const TraceRing&, const TraceEvent& event) {
+            Phase& phase = phases[event.name];
+            ++phase.count;
+            phase.totalNs += event.durationNs;
+            phase.maxNs = max(phase.maxNs, event.durationNs);
+            phase.bytes += event.bytes;
+        });
+    }
+
+    vector<Phase> sorted;
+    for (auto& [name, phase] : phases)
+    {
+        phase.name = name;
+        sorted.push_back(phase);
+    }
+    sort(sorted.begin(), sorted.end(), [](const Phase& a, const Phase& b) { return a.totalNs > b.totalNs; });
+
+    out << left << setw(26) << "phase" << right << setw(8) << "count" << setw(12) << "total ms" << setw(11) << "mean ms"
+        << setw(11) << "max ms" << setw(11) << "MB" << setw(10) << "MB/s" << "\n";
+    for (const auto& phase : sorted)
+    {
+        out << left << setw(26) << phase.name << right << setw(8) << phase.count << fixed << setprecision(2)
+            << setw(12) << phase.totalNs / 1e6 << setw(11) << phase.totalNs / 1e6 / phase.count
+            << setw(11) << phase.maxNs / 1e6;
+        if (phase.bytes > 0)
+        {
+            out << setw(11) << phase.bytes / 1e6
+                << setw(10) << setprecision(1) << (phase.totalNs > 0 ? phase.bytes / 1e6 / (phase.totalNs / 1e9) : 0.0);
+        }
+        out << defaultfloat << "\n";
+    }
+
+    uint64_t dropped = getDropped();
+    if (dropped > 0)   { out << dropped << " older events were overwritten and are not counted.\n"; }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+/* ---------------- Tracing ---------------- */
+/* Timed spans over the loader, the analyses and the exporters, for finding where a slow run spends its time.
+   Off by default: a disabled span costs one relaxed atomic load. Enabled, a span reads the clock twice and
+   appends one event to a ring buffer owned by its thread, so threads never contend; a thread's oldest events
+   are overwritten once it has recorded more than the buffer holds, and counted as dropped.
+   Dump the events with writeChromeTrace (load the file in chrome://tracing or ui.perfetto.dev) or fold them
+   into a per-phase table with writeSummary. Dump while no spans are being recorded, e.g. at the end of a run. */
+class Trace
+{
+    private:
+
+        static inline atomic<bool> enabled{ false };
+
+    public:
+
+        static void enable(bool on = true)   { enabled.store(on, memory_order_relaxed); }
+        static bool isEnabled()              { return enabled.load(memory_order_relaxed); }
+
+        /* Nanoseconds on a steady clock since the first call */
+        static int64_t now();
+
+        /* Append a finished span to the calling thread's ring buffer; 'name' must outlive the trace */
+        static void record(const char* name, int64_t startNs, int64_t durationNs, uint64_t bytes);
+
+        /* Label the calling thread in the timeline */
+        static void setThreadName(const string& name);
+
+        /* Forget every recorded event */
+        static void clear();
+
+        /* Events overwritten before they could be dumped */
+        static uint64_t getDropped();
+
+        /* {"displayTimeUnit": "ms", "traceEvents": [...]}: one complete ("X") event per span, with its bytes in
+           args, and a thread_name metadata event per named thread */
+        static void writeChromeTrace(ostream& out);
+
+        /* Per span name: count, total, mean and longest wall time, bytes and throughput, largest total first.
+           Spans of the same name on several threads add up, so a parallel phase can total more than the run. */
+        static void writeSummary(ostream& out);
+};
+
+/* Times its own lifetime as one span when tracing is enabled. 'name' must be a string literal or otherwise
+   outlive the trace; bytes processed can be given up front or added as they become known. */
+class TraceSpan
+{
+    private:
+
+        const char* name;
+        int64_t start = 0;
+        uint64_t bytes;
+        bool active;
+
+    public:
+
+        explicit TraceSpan(const char* name, uint64_t bytes = 0) : name(name), bytes(bytes), active(Trace::isEnabled())
+        {
+            if (active)   { start = Trace::now(); }
+        }
+
+        ~TraceSpan()
+        {
+            if (active)   { Trace::record(name, start, Trace::now() - start, bytes); }
+        }
+
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+        void addBytes(uint64_t n)   { bytes += n; }
+};
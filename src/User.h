@@ -42,7 +42,26 @@ struct UserWatch
     double watchTime;
     User user;
 
-    bool operator<(const UserWatch& o) const   { return watchTime < o.watchTime; }
+    /* Ties on watch time rank the higher userID lower, so top-k results don't depend on scan order */
+    bool operator<(const UserWatch& o) const
+    {
+        if (watchTime != o.watchTime)   { return watchTime < o.watchTime; }
+        return user.userID > o.user.userID;
+    }
+};
+
+/* UserWatch for a row of a UserTable: same order, without copying the user */
+struct RowWatch
+{
+    double watchTime;
+    int userID;
+    uint32_t row;
+
+    bool operator<(const RowWatch& o) const
+    {
+        if (watchTime != o.watchTime)   { return watchTime < o.watchTime; }
+        return userID > o.userID;
+    }
 };
 
 template class MinHeap<UserWatch>;
@@ -0,0 +1,221 @@
+#include "UserAnalytics.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "Arena.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <string>
+
+using namespace std;
+
+
+/* ---------------- Similarity ---------------- */
+
+double calculateSimilarity(const User& user1, const User& user2)
+{
+    double score = 0.0;
+
+    /* Age similarity (closer in age = higher score) */
+    score += 100.0 / (abs(user1.age - user2.age) + 1);
+
+    if (user1.genre == user2.genre)                 { score += 50.0; }
+    if (user1.country == user2.country)             { score += 30.0; }
+    if (user1.subscription == user2.subscription)   { score += 20.0; }
+
+    /* Watch time similarity */
+    score += 100.0 / (abs(user1.watchTime - user2.watchTime) + 1);
+
+    return score;
+}
+
+Graph buildUserGenreGraph(const vector<User>& users)
+{
+    /* Only the first users are compared, the pairs grow with the square of the count */
+    const size_t MAX_USERS = 100;
+
+    TraceSpan span("genreGraph.build");
+    Graph graph;
+
+    /* The sets are temporaries of views into the users' own strings, all in one arena */
+    ScratchArena<> arena;
+
+    /* One vertex per genre, in alphabetical order */
+    pmr::set<string_view> genres(&arena);
+    for (const auto& user : users)   { genres.insert(user.genre); }
+    for (const auto& genre : genres)   { graph.addVertex(string(genre)); }
+
+    /* Genre pairs already connected, keyed with the names in order */
+    pmr::set<pair<string_view, string_view>> connectedPairs(&arena);
+
+    size_t n = min(users.size(), MAX_USERS);
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = i + 1; j < n; j++)
+        {
+            if (users[i].genre == users[j].genre)   { continue; }
+
+            string_view genre1 = users[i].genre;
+            string_view genre2 = users[j].genre;
+            if (genre1 > genre2)   { swap(genre1, genre2); }
+
+            pair<string_view, string_view> genrePair = { genre1, genre2 };
+            if (connectedPairs.count(genrePair) > 0)   { continue; }
+
+            /* Only connect if there's meaningful similarity */
+            if (calculateSimilarity(users[i], users[j]) > 70.0)
+            {
+                graph.addEdge(string(genre1), string(genre2));
+                connectedPairs.insert(genrePair);
+            }
+        }
+    }
+
+    return graph;
+}
+
+vector<UserSimilarity> findMostSimilarUsers(const vector<User>& users, unsigned int k)
+{
+    const size_t MAX_USERS = 100;
+
+    TraceSpan span("similar");
+    size_t n = min(users.size(), MAX_USERS);
+
+    /* UserSimilarity orders the heap root as the most similar pair, so the top k are the first k removals.
+       Pre-size for every pair so the scoring loop never reallocates. */
+    MinHeap<UserSimilarity> heap;
+    heap.reserve(n > 1 ? n * (n - 1) / 2 : 0);
+
+    /* Score the pairs in parallel, row by row, into one slot per pair (row i's pairs start at pairStart(i)),
+       then insert them in the same order as a nested loop would, so ties come out of the heap unchanged. */
+    auto pairStart = [n](size_t i) { return i * (2 * n - i - 1) / 2; };
+    vector<double> scores(n > 1 ? n * (n - 1) / 2 : 0);
+    parallelFor(0, n, 16, [&](size_t lo, size_t hi) {
+        TraceSpan score("similar.score");
+        for (size_t i = lo; i < hi; i++)
+        {
+            for (size_t j = i + 1; j < n; j++)   { scores[pairStart(i) + (j - i - 1)] = calculateSimilarity(users[i], users[j]); }
+        }
+    });
+
+    TraceSpan heapSpan("similar.heap");
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = i + 1; j < n; j++)
+        {
+            UserSimilarity similarity;
+            similarity.user1ID = users[i].userID;
+            similarity.user2ID = users[j].userID;
+            similarity.similarity = scores[pairStart(i) + (j - i - 1)];
+
+            heap.insert(similarity);
+        }
+    }
+
+    /* Take the results in descending order of similarity */
+    vector<UserSimilarity> topSimilarities;
+    topSimilarities.reserve(min<size_t>(k, heap.getSize()));
+    while (topSimilarities.size() < k && heap.getSize() > 0)
+    {
+        topSimilarities.push_back(heap.getMin());
+        heap.removeMin();
+    }
+
+    return topSimilarities;
+}
+
+
+/* ---------------- Most Active Users ---------------- */
+
+vector<User> activeUsersFromHeap(FixedMinHeap<UserWatch>& heap)
+{
+    vector<User> result;
+    vector<UserWatch> buf;
+    while (heap.empty() == false)
+    {
+        buf.push_back(heap.getMin());
+        heap.removeMin();
+    }
+
+    reverse(buf.begin(), buf.end());
+
+    for (auto& uw : buf)
+       { result.push_back(uw.user); }
+
+    return result;
+}
+
+vector<User> findMostActiveUsers(const vector<User>& users, int k)
+{
+    TraceSpan span("active.heap");
+    FixedMinHeap<UserWatch> heap(k);
+
+    for (auto& u : users)
+    {
+        UserWatch uw{ u.watchTime, u };
+        heap.insert(uw);
+    }
+
+    return activeUsersFromHeap(heap);
+}
+
+vector<User> findMostActiveUsersParallel(const vector<User>& users, int k, unsigned int threadCount)
+{
+    /* Keep enough users per slice that the heap work outweighs scheduling its task */
+    const size_t MIN_USERS_PER_THREAD = 4096;
+
+    TraceSpan span("active.parallel");
+    if (threadCount == 0)   { threadCount = ThreadPool::shared().getThreadCount(); }
+    threadCount = (unsigned int)min<size_t>(threadCount, max<size_t>(1, users.size() / MIN_USERS_PER_THREAD));
+
+    /* The heaps hold (watchTime, userID, row), in the same order as UserWatch; copying a whole User into every
+       candidate would cost more than the split saves. Users are copied only for the final top k. */
+    vector<FixedMinHeap<RowWatch>> heaps(threadCount, FixedMinHeap<RowWatch>(k));
+    size_t chunk = (users.size() + threadCount - 1) / threadCount;
+
+    parallelFor(0, threadCount, 1, [&](size_t t, size_t) {
+        TraceSpan slice("active.slice");
+        size_t begin = min(users.size(), t * chunk);
+        size_t end = min(users.size(), begin + chunk);
+        for (size_t i = begin; i < end; ++i)   { heaps[t].insert(RowWatch{ users[i].watchTime, users[i].userID, (uint32_t)i }); }
+    });
+
+    /* Only large heaps are worth merging as separate tasks */
+    TraceSpan reduce("active.reduce");
+    FixedMinHeap<RowWatch> heap = reduceHeaps(heaps, k >= (int)MIN_USERS_PER_THREAD);
+
+    vector<uint32_t> rows;
+    while (heap.empty() == false)
+    {
+        rows.push_back(heap.getMin().row);
+        heap.removeMin();
+    }
+
+    vector<User> result;
+    result.reserve(rows.size());
+    for (auto it = rows.rbegin(); it != rows.rend(); ++it)   { result.push_back(users[*it]); }
+    return result;
+}
+
+vector<User> findMostActiveUsersByGraph(const vector<User>& users, int k)
+{
+    TraceSpan span("active.graph");
+    vector<User> activeUsers;
+    if (users.empty())   { return activeUsers; }
+
+    /* Find the index of the user with the highest watch time */
+    int highestWatch = 0;
+    for (int i = 1; i < (int)users.size(); ++i)
+    {
+        if (users[i].watchTime > users[highestWatch].watchTime)   { highestWatch = i; }
+    }
+
+    /* Build the graph, then map the indices of the closest users back to User objects */
+    ActivityGraph ag = buildActivityGraph(users, highestWatch);
+    auto graphResult = ag.topKClosest(highestWatch, k);
+    activeUsers.reserve(graphResult.size());
+    for (int index : graphResult)
+       { activeUsers.push_back(users[index]); }
+
+    return activeUsers;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "User.h"
+#include "Graph.h"
+#include "MinHeap.h"
+#include <vector>
+
+using namespace std;
+
+/* The menu's analyses that work on the loaded users themselves rather than on the UserTable */
+
+/* ---------------- Similarity (options 5 and 6) ---------------- */
+/* Closer ages and watch times score higher, and so do a shared genre, country and subscription */
+double calculateSimilarity(const User& user1, const User& user2);
+
+/* Genres as vertices, with an edge between two genres once any pair of their users among the first 100
+   scores above 70 */
+Graph buildUserGenreGraph(const vector<User>& users);
+
+/* The k most similar pairs among the first 100 users, most similar first */
+vector<UserSimilarity> findMostSimilarUsers(const vector<User>& users, unsigned int k);
+
+/* ---------------- Most Active Users (option 8) ---------------- */
+/* Drain a heap of the most active users into a list ordered from most to least active */
+vector<User> activeUsersFromHeap(FixedMinHeap<UserWatch>& heap);
+
+/* One pass through a Fixed-Size Min-Heap of k users */
+vector<User> findMostActiveUsers(const vector<User>& users, int k);
+
+/* One Fixed-Size Min-Heap per slice, each filled as a task on the shared pool, then tree-reduced into one.
+   UserWatch orders ties by userID, so the result is identical to findMostActiveUsers. */
+vector<User> findMostActiveUsersParallel(const vector<User>& users, int k, unsigned int threadCount = 0);
+
+/* The k users closest in watch time to the most active one, through an ActivityGraph centred on them */
+vector<User> findMostActiveUsersByGraph(const vector<User>& users, int k);
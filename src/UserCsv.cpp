@@ -0,0 +1,109 @@
+#include "UserCsv.h"
+#include "Trace.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+
+using namespace std;
+
+
+/* Chunks this size keep a task's work well above the cost of scheduling it */
+static const size_t CHUNK_BYTES = 1 << 20;
+
+/* The next comma-separated field of 'line', which is advanced past it; empty once the line is used up */
+static string_view nextField(string_view& line)
+{
+    size_t comma = line.find(',');
+    string_view field = line.substr(0, comma);
+    line = comma == string_view::npos ? string_view() : line.substr(comma + 1);
+    return field;
+}
+
+/* The users parseLines() finds in 'text': one per line, the last one whether or not it ends in a line break */
+static size_t countLines(string_view text)
+{
+    size_t lines = (size_t)count(text.begin(), text.end(), '\n');
+    if (text.empty() == false && text.back() != '\n')   { ++lines; }
+    return lines;
+}
+
+/* Parse the lines of 'text' into consecutive users starting at 'out' */
+static void parseLines(string_view text, User* out)
+{
+    TraceSpan span("csv.parseChunk", text.size());
+    string number;
+    auto toInt = [&number](string_view field) { number.assign(field); return stoi(number); };
+    auto toDouble = [&number](string_view field) { number.assign(field); return stod(number); };
+
+    while (text.empty() == false)
+    {
+        size_t newline = text.find('\n');
+        string_view line = text.substr(0, newline);
+        text = newline == string_view::npos ? string_view() : text.substr(newline + 1);
+
+        User& user = *out++;
+        user.userID = toInt(nextField(line));
+        user.name = nextField(line);
+        user.age = toInt(nextField(line));
+        user.country = nextField(line);
+        user.subscription = nextField(line);
+        user.watchTime = toDouble(nextField(line));
+        user.genre = nextField(line);
+        user.lastLogin = nextField(line);
+    }
+}
+
+vector<User> parseUsersCsv(string_view text, ThreadPool& pool)
+{
+    TraceSpan span("csv.parse", text.size());
+
+    /* Skip the header line */
+    size_t headerEnd = text.find('\n');
+    text = headerEnd == string_view::npos ? string_view() : text.substr(headerEnd + 1);
+
+    /* Every chunk but the last ends just after a line break */
+    vector<size_t> bounds = { 0 };
+    while (text.size() - bounds.back() > CHUNK_BYTES)
+    {
+        size_t newline = text.find('\n', bounds.back() + CHUNK_BYTES);
+        if (newline == string_view::npos)   { break; }
+        bounds.push_back(newline + 1);
+    }
+    bounds.push_back(text.size());
+
+    /* Counting the lines first gives every chunk its place in the result, so the chunks parse straight into it
+       instead of into vectors of their own that would then have to be joined, with both held at once */
+    size_t chunks = bounds.size() - 1;
+    vector<size_t> offsets(chunks + 1, 0);
+    parallelFor(0, chunks, 1, [&](size_t lo, size_t hi) {
+        for (size_t c = lo; c < hi; ++c)   { offsets[c + 1] = countLines(text.substr(bounds[c], bounds[c + 1] - bounds[c])); }
+    }, pool);
+    for (size_t c = 0; c < chunks; ++c)   { offsets[c + 1] += offsets[c]; }
+
+    vector<User> users(offsets[chunks]);
+    parallelFor(0, chunks, 1, [&](size_t lo, size_t hi) {
+        for (size_t c = lo; c < hi; ++c)
+           { parseLines(text.substr(bounds[c], bounds[c + 1] - bounds[c]), users.data() + offsets[c]); }
+    }, pool);
+    return users;
+}
+
+vector<User> readUsersFromCSV(const string& filename)
+{
+    ifstream file(filename, ios::binary);
+
+    if (!file.is_open())
+    {
+        cout << "Error opening file: " << filename << endl;
+        return {};
+    }
+
+    string text;
+    {
+        TraceSpan span("csv.read");
+        text.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        span.addBytes(text.size());
+    }
+    return parseUsersCsv(text);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "User.h"
+#include "ThreadPool.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/* ---------------- User CSV ---------------- */
+/* Users from the text of netflix_users.csv: a header line, then
+   userID,name,age,country,subscription,watchTime,genre,lastLogin
+   per line. The text is cut into chunks at line breaks and the chunks are parsed as tasks on 'pool', each
+   into its own slice of the result, so the users come out exactly as a line-by-line read would give them and
+   the heap holds only the text and the result. Numbers are read
+   with stoi/stod; a malformed number throws their invalid_argument or out_of_range. */
+vector<User> parseUsersCsv(string_view text, ThreadPool& pool = ThreadPool::shared());
+
+/* The users of a CSV file. Tells cout and returns no users if the file cannot be opened. */
+vector<User> readUsersFromCSV(const string& filename);
@@ -0,0 +1,300 @@
+#include "UserIndex.h"
+#include "Trace.h"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+using namespace std;
+
+
+/* ---------------- Bitmap Index ---------------- */
+
+BitmapIndex buildBitmapIndex(const UserTable& table)
+{
+    BitmapIndex index;
+    index.countries.resize(table.countries.size());
+    index.subscriptions.resize(table.subscriptions.size());
+    index.genres.resize(table.genres.size());
+
+    /* Rows go in ascending order, so every add appends to the bitmap's last container */
+    for (uint32_t row = 0; row < table.size(); ++row)
+    {
+        index.countries[table.countryCodes[row]].add(row);
+        index.subscriptions[table.subscriptionCodes[row]].add(row);
+        index.genres[table.genreCodes[row]].add(row);
+        index.all.add(row);
+    }
+
+    return index;
+}
+
+const RowBitmap& BitmapIndex::rowsWith(Column column, int code) const
+{
+    switch (column)
+    {
+        case Column::Country:       return countries.at(code);
+        case Column::Subscription:  return subscriptions.at(code);
+        case Column::Genre:         return genres.at(code);
+        default:                    break;
+    }
+    throw invalid_argument(columnName(column) + " has no bitmap index");
+}
+
+shared_ptr<const RowBitmap> BitmapIndex::matchAll(const vector<RowFilter>& equalities) const
+{
+    /* Shares nothing: a view of a bitmap the index owns */
+    auto view = [](const RowBitmap& rows) { return shared_ptr<const RowBitmap>(shared_ptr<const RowBitmap>(), &rows); };
+
+    vector<pair<uint64_t, const RowBitmap*>> operands;
+    for (const auto& f : equalities)
+    {
+        if (f.minValue != f.maxValue)   { throw invalid_argument("Bitmap filters must be equality filters"); }
+        const RowBitmap& rows = rowsWith(f.column, (int)f.minValue);
+        operands.push_back({ rows.cardinality(), &rows });
+    }
+    if (operands.empty())       { return view(all); }
+    if (operands.size() == 1)   { return view(*operands[0].second); }
+
+    /* Starting from the smallest operand keeps every intermediate result small */
+    sort(operands.begin(), operands.end(),
+         [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    RowBitmap result = *operands[0].second & *operands[1].second;
+    for (size_t i = 2; i < operands.size() && result.empty() == false; ++i)   { result = result & *operands[i].second; }
+
+    return make_shared<const RowBitmap>(move(result));
+}
+
+size_t BitmapIndex::memoryBytes() const
+{
+    size_t bytes = all.memoryBytes();
+    for (const auto& b : countries)       { bytes += b.memoryBytes(); }
+    for (const auto& b : subscriptions)   { bytes += b.memoryBytes(); }
+    for (const auto& b : genres)          { bytes += b.memoryBytes(); }
+    return bytes;
+}
+
+
+/* ---------------- Sorted Index ---------------- */
+
+SortedIndex buildAgeIndex(const UserTable& table)
+{
+    SortedIndex index;
+    size_t n = table.size();
+
+    /* start[a] = position of the first row aged a; negative ages sort first */
+    vector<size_t> start(max(table.maxAge, 0) + 2, 0);
+    size_t negatives = 0;
+    for (int age : table.ages)
+    {
+        if (age < 0)   { ++negatives; }
+        else           { ++start[age + 1]; }
+    }
+    start[0] = negatives;
+    for (size_t a = 1; a < start.size(); ++a)   { start[a] += start[a - 1]; }
+
+    index.values.resize(n);
+    index.rows.resize(n);
+
+    vector<uint32_t> negativeRows;
+    for (uint32_t row = 0; row < n; ++row)
+    {
+        int age = table.ages[row];
+        if (age < 0)
+        {
+            negativeRows.push_back(row);
+            continue;
+        }
+        size_t pos = start[age]++;
+        index.values[pos] = age;
+        index.rows[pos] = row;
+    }
+
+    stable_sort(negativeRows.begin(), negativeRows.end(),
+                [&table](uint32_t a, uint32_t b) { return table.ages[a] < table.ages[b]; });
+    for (size_t i = 0; i < negativeRows.size(); ++i)
+    {
+        index.rows[i] = negativeRows[i];
+        index.values[i] = table.ages[negativeRows[i]];
+    }
+
+    return index;
+}
+
+SortedIndex buildWatchTimeIndex(const UserTable& table)
+{
+    size_t n = table.size();
+
+    /* Sort the keys themselves rather than row ids through the columns, so comparisons stay in cache */
+    struct Entry { double watchTime; int userID; uint32_t row; };
+    vector<Entry> entries(n);
+    for (uint32_t row = 0; row < n; ++row)   { entries[row] = { table.watchTimes[row], table.userIDs[row], row }; }
+
+    sort(entries.begin(), entries.end(),
+         [](const Entry& a, const Entry& b) {
+             if (a.watchTime != b.watchTime)   { return a.watchTime < b.watchTime; }
+             if (a.userID != b.userID)         { return a.userID > b.userID; }
+             return a.row < b.row;
+         });
+
+    SortedIndex index;
+    index.values.resize(n);
+    index.rows.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        index.values[i] = entries[i].watchTime;
+        index.rows[i] = entries[i].row;
+    }
+
+    return index;
+}
+
+pair<size_t, size_t> SortedIndex::range(double lo, double hi) const
+{
+    if (lo > hi)   { return { 0, 0 }; }
+
+    size_t first = lower_bound(values.begin(), values.end(), lo) - values.begin();
+    size_t last = upper_bound(values.begin() + first, values.end(), hi) - values.begin();
+    return { first, last };
+}
+
+vector<uint32_t> SortedIndex::rowsInRange(double lo, double hi) const
+{
+    auto [first, last] = range(lo, hi);
+    return vector<uint32_t>(rows.begin() + first, rows.begin() + last);
+}
+
+vector<uint32_t> SortedIndex::top(size_t k) const
+{
+    k = min(k, rows.size());
+    return vector<uint32_t>(rows.rbegin(), rows.rbegin() + k);
+}
+
+size_t SortedIndex::memoryBytes() const
+{
+    return values.capacity() * sizeof(double) + rows.capacity() * sizeof(uint32_t);
+}
+
+
+/* ---------------- UserID Index ---------------- */
+
+/* Folds the high bits into the low ones: the identity for IDs smaller than the table, while IDs that differ
+   only above the mask still spread out */
+static size_t userIdSlot(int userID, size_t mask, int bits)
+{
+    uint32_t id = (uint32_t)userID;
+    return (id ^ (bits < 32 ? id >> bits : 0)) & mask;
+}
+
+UserIdIndex buildUserIdIndex(const UserTable& table)
+{
+    UserIdIndex index;
+    size_t n = table.size();
+
+    int bits = 4;
+    while (((size_t)1 << bits) * 4 < n * 5)   { ++bits; }
+    size_t mask = ((size_t)1 << bits) - 1;
+    index.slots.assign(mask + 1, 0);
+
+    for (uint32_t row = 0; row < n; ++row)
+    {
+        int id = table.userIDs[row];
+        uint32_t probe = 1;
+        size_t slot = userIdSlot(id, mask, bits);
+        while (index.slots[slot] != 0 && table.userIDs[index.slots[slot] - 1] != id)
+        {
+            slot = (slot + 1) & mask;
+            ++probe;
+        }
+        if (index.slots[slot] == 0)   { index.slots[slot] = row + 1; }
+        index.maxProbe = max(index.maxProbe, probe);
+    }
+
+    return index;
+}
+
+long long UserIdIndex::find(const UserTable& table, int userID) const
+{
+    if (slots.empty())   { return -1; }
+
+    size_t mask = slots.size() - 1;
+    size_t slot = userIdSlot(userID, mask, countr_zero(slots.size()));
+    while (slots[slot] != 0)
+    {
+        uint32_t row = slots[slot] - 1;
+        if (table.userIDs[row] == userID)   { return row; }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+size_t UserIdIndex::memoryBytes() const
+{
+    return slots.capacity() * sizeof(uint32_t);
+}
+
+
+/* ---------------- User Index ---------------- */
+
+UserIndex buildUserIndex(const UserTable& table)
+{
+    TraceSpan span("index.build");
+    UserIndex index;
+    index.bitmaps = buildBitmapIndex(table);
+    index.byAge = buildAgeIndex(table);
+    index.byWatchTime = buildWatchTimeIndex(table);
+    index.byUserID = buildUserIdIndex(table);
+    return index;
+}
+
+shared_ptr<const RowBitmap> UserIndex::select(const UserTable& table, const vector<RowFilter>& filters) const
+{
+    vector<RowFilter> equalities, ranges;
+    for (const auto& f : filters)
+    {
+        if (f.column == Column::Age || f.column == Column::WatchTime)   { ranges.push_back(f); }
+        else                                                            { equalities.push_back(f); }
+    }
+
+    /* Narrowest range filter, by the size of its slice of the sorted index */
+    const SortedIndex* narrowest = nullptr;
+    pair<size_t, size_t> slice;
+    for (const auto& f : ranges)
+    {
+        const SortedIndex& sorted = f.column == Column::Age ? byAge : byWatchTime;
+        auto r = sorted.range(f.minValue, f.maxValue);
+        if (narrowest == nullptr || r.second - r.first < slice.second - slice.first)
+        {
+            narrowest = &sorted;
+            slice = r;
+        }
+    }
+
+    shared_ptr<const RowBitmap> candidates = bitmaps.matchAll(equalities);
+    if (ranges.empty())   { return candidates; }
+
+    RowBitmap result;
+    if (slice.second - slice.first < candidates->cardinality())
+    {
+        /* The range slice is the smaller side: collect its rows in row order and test everything else */
+        vector<uint32_t> rows(narrowest->rows.begin() + slice.first, narrowest->rows.begin() + slice.second);
+        sort(rows.begin(), rows.end());
+        for (uint32_t row : rows)
+        {
+            if (rowPasses(table, filters, row))   { result.add(row); }
+        }
+    }
+    else
+    {
+        candidates->forEach([&](uint32_t row) {
+            if (rowPasses(table, ranges, row))   { result.add(row); }
+        });
+    }
+
+    return make_shared<const RowBitmap>(move(result));
+}
+
+size_t UserIndex::memoryBytes() const
+{
+    return bitmaps.memoryBytes() + byAge.memoryBytes() + byWatchTime.memoryBytes() + byUserID.memoryBytes();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "UserTable.h"
+#include "GroupBy.h"
+#include "RowBitmap.h"
+#include <vector>
+#include <memory>
+
+using namespace std;
+
+/* Secondary indexes over a UserTable, built once when the data is loaded */
+
+/* ---------------- Bitmap Index ---------------- */
+/* One RowBitmap per distinct value of each categorical column, indexed by dictionary code */
+struct BitmapIndex
+{
+    vector<RowBitmap> countries;
+    vector<RowBitmap> subscriptions;
+    vector<RowBitmap> genres;
+    RowBitmap all;                      /* every row */
+
+    /* Rows whose column equals the given code; throws invalid_argument for columns without a bitmap index */
+    const RowBitmap& rowsWith(Column column, int code) const;
+
+    /* Rows passing every equality filter (ANDed, smallest bitmap first); no filters selects every row.
+       Filters must be RowFilter::equals on Country, Subscription or Genre. Without an intersection to compute
+       (no filter or one) the result points at the index's own bitmap rather than a copy of it, so it must not
+       outlive the index. */
+    shared_ptr<const RowBitmap> matchAll(const vector<RowFilter>& equalities) const;
+
+    size_t memoryBytes() const;
+};
+
+BitmapIndex buildBitmapIndex(const UserTable& table);
+
+/* ---------------- Sorted Index ---------------- */
+/* Permutation of the rows ordered by one numeric column, with the sorted values alongside for binary search */
+struct SortedIndex
+{
+    vector<double> values;              /* ascending */
+    vector<uint32_t> rows;              /* rows[i] holds values[i] */
+
+    /* Positions [first, last) of the rows with lo <= value <= hi, found in O(log n) */
+    pair<size_t, size_t> range(double lo, double hi) const;
+
+    /* Rows with lo <= value <= hi, in value order */
+    vector<uint32_t> rowsInRange(double lo, double hi) const;
+
+    /* The k rows with the largest values, largest first: a read of the index tail */
+    vector<uint32_t> top(size_t k) const;
+
+    size_t memoryBytes() const;
+};
+
+/* Ages are small integers, so this is a stable counting sort: equal ages stay in row order */
+SortedIndex buildAgeIndex(const UserTable& table);
+
+/* Equal watch times are ordered by descending userID, so top() ranks ties by ascending userID like UserWatch */
+SortedIndex buildWatchTimeIndex(const UserTable& table);
+
+/* ---------------- UserID Index ---------------- */
+/* Open-addressing hash from userID to row. Slots hold row + 1 (0 marks an empty slot) and a hit is confirmed
+   against the table's userID column, so the index costs 4 bytes per slot and stores no keys. The table keeps
+   at most 80% of its slots full. For IDs below the slot count the hash is the ID itself, so sequential IDs
+   never collide and each lookup is a single probe. */
+struct UserIdIndex
+{
+    vector<uint32_t> slots;             /* power-of-two length */
+    uint32_t maxProbe = 0;              /* longest probe sequence seen while building */
+
+    /* Row of the user with this ID, or -1; with duplicate IDs the first row wins */
+    long long find(const UserTable& table, int userID) const;
+
+    size_t memoryBytes() const;
+};
+
+UserIdIndex buildUserIdIndex(const UserTable& table);
+
+/* ---------------- User Index ---------------- */
+struct UserIndex
+{
+    BitmapIndex bitmaps;
+    SortedIndex byAge;
+    SortedIndex byWatchTime;
+    UserIdIndex byUserID;
+
+    /* Rows passing every filter: equalities on country, subscription or genre, ranges on age or watchTime.
+       Starts from whichever index gives the fewest candidates, O(log n + candidates), and checks the other
+       filters on those rows only. Equality filters alone give matchAll()'s result, which may point into the
+       index. */
+    shared_ptr<const RowBitmap> select(const UserTable& table, const vector<RowFilter>& filters) const;
+
+    size_t memoryBytes() const;
+};
+
+UserIndex buildUserIndex(const UserTable& table);
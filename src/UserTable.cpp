@@ -0,0 +1,82 @@
+#include "UserTable.h"
+#include "Trace.h"
+#include <stdexcept>
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+
+/* ---------------- Dictionary ---------------- */
+
+uint16_t Dictionary::encode(const string& value)
+{
+    auto it = codes.find(value);
+    if (it != codes.end())   { return it->second; }
+
+    if (values.size() > UINT16_MAX)   { throw runtime_error("Too many distinct values for a dictionary column!"); }
+
+    uint16_t code = (uint16_t)values.size();
+    values.push_back(value);
+    codes.emplace(value, code);
+    return code;
+}
+
+int Dictionary::find(const string& value) const
+{
+    auto it = codes.find(value);
+    return it == codes.end() ? -1 : it->second;
+}
+
+const string& Dictionary::decode(uint16_t code) const   { return values.at(code); }
+
+unsigned int Dictionary::size() const   { return values.size(); }
+
+
+/* ---------------- UserTable ---------------- */
+
+UserTable buildUserTable(const vector<User>& users)
+{
+    TraceSpan span("table.build");
+    UserTable table;
+    size_t n = users.size();
+
+    table.countryCodes.reserve(n);
+    table.subscriptionCodes.reserve(n);
+    table.genreCodes.reserve(n);
+    table.loginMonthCodes.reserve(n);
+    table.userIDs.reserve(n);
+    table.ages.reserve(n);
+    table.watchTimes.reserve(n);
+    table.loginDays.reserve(n);
+
+    for (const auto& u : users)
+    {
+        table.countryCodes.push_back(table.countries.encode(u.country));
+        table.subscriptionCodes.push_back(table.subscriptions.encode(u.subscription));
+        table.genreCodes.push_back(table.genres.encode(u.genre));
+        table.loginMonthCodes.push_back(table.loginMonths.encode(u.lastLogin.substr(0, 7)));
+        table.userIDs.push_back(u.userID);
+        table.ages.push_back(u.age);
+        table.maxAge = max(table.maxAge, u.age);
+        table.watchTimes.push_back(u.watchTime);
+
+        int32_t day = parseDay(u.lastLogin);
+        table.loginDays.push_back(day);
+        if (day != NO_DAY)
+        {
+            table.firstLoginDay = table.firstLoginDay == NO_DAY ? day : min(table.firstLoginDay, day);
+            table.lastLoginDay = max(table.lastLoginDay, day);
+        }
+    }
+
+    return table;
+}
+
+unsigned int scanThreadCount(size_t rows, unsigned int requested)
+{
+    const size_t MIN_ROWS_PER_THREAD = 16384;
+
+    if (requested == 0)   { requested = max(1u, thread::hardware_concurrency()); }
+    return (unsigned int)min<size_t>(requested, max<size_t>(1, rows / MIN_ROWS_PER_THREAD));
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "User.h"
+#include "Dates.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+using namespace std;
+
+/* Column-wise copy of the loaded users: categorical columns are dictionary-encoded to small dense codes,
+   so analyses can index flat counter arrays instead of looking strings up in maps */
+
+/* ---------------- Dictionary ---------------- */
+/* Assigns codes 0, 1, 2, ... to distinct strings in order of first appearance */
+class Dictionary
+{
+    private:
+
+        vector<string> values;
+        unordered_map<string, uint16_t> codes;
+
+    public:
+
+        /* Return the code of 'value', adding it if it is new */
+        uint16_t encode(const string& value);
+
+        /* Return the code of 'value', or -1 if it was never encoded */
+        int find(const string& value) const;
+
+        const string& decode(uint16_t code) const;
+        unsigned int size() const;
+};
+
+/* ---------------- UserTable ---------------- */
+struct UserTable
+{
+    Dictionary countries;
+    Dictionary subscriptions;
+    Dictionary genres;
+    Dictionary loginMonths;     /* "YYYY-MM" prefix of lastLogin */
+
+    /* One entry per user, in the same order as the vector<User> the table was built from */
+    vector<uint16_t> countryCodes;
+    vector<uint16_t> subscriptionCodes;
+    vector<uint16_t> genreCodes;
+    vector<uint16_t> loginMonthCodes;
+    vector<int>      userIDs;
+    vector<int>      ages;
+    vector<double>   watchTimes;
+    vector<int32_t>  loginDays;     /* lastLogin as a day number, NO_DAY when it is not a YYYY-MM-DD date */
+
+    int maxAge = -1;            /* largest age in 'ages', -1 when empty */
+    int32_t firstLoginDay = NO_DAY;     /* earliest and latest of 'loginDays', NO_DAY when none is a date */
+    int32_t lastLoginDay = NO_DAY;
+
+    size_t size() const   { return ages.size(); }
+};
+
+UserTable buildUserTable(const vector<User>& users);
+
+/* Number of threads to scan 'rows' rows with: 'requested' (0 = every hardware thread), but never so many
+   that a thread gets only a sliver of the table */
+unsigned int scanThreadCount(size_t rows, unsigned int requested);
@@ -1,6 +1,17 @@
 #include "User.h"
 #include "Graph.h"
 #include "MinHeap.h"
+#include "UserTable.h"
+#include "Analytics.h"
+#include "Export.h"
+#include "HttpServer.h"
+#include "ResultCache.h"
+#include "ThreadPool.h"
+#include "UserCsv.h"
+#include "UserAnalytics.h"
+#include "Synthetic.h"
+#include "Trace.h"
+#include "MemoryStats.h"
 
 #include <iostream>
 #include <vector>
@@ -15,419 +26,788 @@
 #include <filesystem>
 #include <set>
 #include <chrono>
+#include <csignal>
 
 using namespace std;
 
 
 
-// Function to calculate similarity score between users
-double calculateSimilarity(const User& user1, const User& user2) {
-    double score = 0.0;
+void exportGraphToJson(const Graph& graph, const string& filepath, const Exporter& exporter) {
+    MemoryScope memory("export");
+    exporter.write(filepath, [&](JsonWriter& writer) { writeGraph(writer, graph); }, true);
+}
 
-    // Age similarity (closer in age = higher score)
-    score += 100.0 / (abs(user1.age - user2.age) + 1);
 
-    // Genre match
-    if (user1.genre == user2.genre) {
-        score += 50.0;
-    }
+// Each pair carries both users' details, looked up by ID through the index
+void writeSimilaritiesToJSON(const vector<UserSimilarity>& sims,
+                             const vector<User>& users,
+                             const UserTable& table,
+                             const UserIdIndex& byUserID,
+                             const filesystem::path& filePath,
+                             const Exporter& exporter)
+{
+    MemoryScope memory("export");
+    bool written = exporter.write(filePath,
+        [&](JsonWriter& writer) { writeSimilarities(writer, sims, users, table, byUserID); });
 
-    // Country match
-    if (user1.country == user2.country) {
-        score += 30.0;
+    if (written) {
+        cout << "Wrote " << sims.size() << " pairs → "
+                  << filesystem::absolute(exporter.pathFor(filePath)) << '\n';
     }
+}
 
-    // Subscription match
-    if (user1.subscription == user2.subscription) {
-        score += 20.0;
-    }
+// Size and write time of the all-users export in every format, written to memory so the disk does not count,
+// and its size once gzipped
+void compareExportFormats(const vector<User>& users) {
+    const ExportFormat formats[] = { ExportFormat::Json, ExportFormat::CompactJson, ExportFormat::NDJson,
+                                     ExportFormat::Cbor, ExportFormat::MessagePack };
+    size_t jsonBytes = 0;
+
+    cout << left << setw(10) << "format" << right << setw(14) << "bytes" << setw(10) << "vs json" << setw(12) << "ms"
+         << setw(14) << "gzip bytes" << setw(10) << "vs json" << '\n';
+    for (ExportFormat format : formats) {
+        ostringstream out(isBinaryFormat(format) ? ios::out | ios::binary : ios::out);
+        auto start = chrono::high_resolution_clock::now();
+        {
+            JsonWriter writer(out, format);
+            writeUsers(writer, users);
+        }
+        auto finish = chrono::high_resolution_clock::now();
 
-    // Watch time similarity
-    score += 100.0 / (abs(user1.watchTime - user2.watchTime) + 1);
+        size_t bytes = out.view().size();
+        if (format == ExportFormat::Json) jsonBytes = bytes;
+        cout << left << setw(10) << exportFormatName(format) << right << setw(14) << bytes
+             << setw(9) << fixed << setprecision(1) << 100.0 * bytes / max<size_t>(jsonBytes, 1) << '%'
+             << setw(12) << setprecision(2) << chrono::duration<double, milli>(finish - start).count();
 
-    return score;
+        size_t gzipBytes = gzipCompress(out.view()).size();
+        cout << setw(14) << gzipBytes << setw(9) << setprecision(1) << 100.0 * gzipBytes / max<size_t>(jsonBytes, 1) << '%'
+             << defaultfloat << '\n';
+    }
 }
 
-// Function to read users from CSV file
-vector<User> readUsersFromCSV(const string& filename) {
+// Generate sample data for testing
+vector<User> generateSampleData() {
     vector<User> users;
-    ifstream file(filename);
 
-    if (!file.is_open()) {
-        cout << "Error opening file: " << filename << endl;
-        return users;
-    }
-
-    string line;
-    // Skip header line
-    getline(file, line);
+    // Sample user data
+    string genres[] = { "Comedy", "Drama", "Action", "Horror", "Romance", "Documentary" };
+    string countries[] = { "USA", "Canada", "UK", "France", "Germany", "Japan" };
+    string subscriptions[] = { "Basic", "Standard", "Premium" };
 
-    while (getline(file, line)) {
+    for (int i = 1; i <= 20; i++) {
         User user;
-        stringstream ss(line);
-        string token;
-
-        getline(ss, token, ',');
-        user.userID = stoi(token);
-
-        getline(ss, user.name, ',');
-
-        getline(ss, token, ',');
-        user.age = stoi(token);
-
-        getline(ss, user.country, ',');
-        getline(ss, user.subscription, ',');
-
-        getline(ss, token, ',');
-        user.watchTime = stod(token);
-
-        getline(ss, user.genre, ',');
-        getline(ss, user.lastLogin, ',');
+        user.userID = i;
+        user.name = "User" + to_string(i);
+        user.age = 18 + (i % 40); // Ages from 18 to 57
+        user.country = countries[i % 6];
+        user.subscription = subscriptions[i % 3];
+        user.watchTime = 10.0 + (i * 2.5); // Different watch times
+        user.genre = genres[i % 6];
+        user.lastLogin = "2023-04-" + (i < 10 ? "0" + to_string(i) : to_string(i));
 
         users.push_back(user);
     }
 
-    file.close();
     return users;
 }
 
-// Function to find most common genre for a specific age group
-string findMostCommonGenreForAgeGroup(const vector<User>& users, int minAge, int maxAge) {
-    map<string, int> genreCounts;
+// Where the frontend reads the exports from
+const string DATA_DIR = "../frontend/flixhabit-frontend/public/data/";
 
-    for (const auto& user : users) {
-        if (user.age >= minAge && user.age <= maxAge) {
-            genreCounts[user.genre]++;
-        }
+// Everything the menu and the batch commands work on: the loaded users with their table and indexes,
+// and how exports are written
+struct Session {
+    vector<User> users;
+    UserTable table;                   // dictionary-encoded columns of 'users', rebuilt on every load
+    UserIndex index;                   // bitmap and sorted indexes of 'table'
+    BackgroundCompressor compressor;   // writes the .gz siblings of the exports off the main thread
+    ETagManifest etags{ DATA_DIR + "etags.json" };   // hashes of the exports, so unchanged ones are not rewritten
+    Exporter exporter;                 // format and compression of every export, chosen with option 12
+    uint64_t version = 0;              // bumped whenever 'users' changes
+    mutable ResultCache cache;         // analyses of the current version, repeated queries are answered from here
+
+    Session() {
+        exporter.compressor = &compressor;
+        exporter.etags = &etags;
     }
 
-    string mostCommonGenre = "";
-    int maxCount = 0;
-
-    for (const auto& pair : genreCounts) {
-        if (pair.second > maxCount) {
-            maxCount = pair.second;
-            mostCommonGenre = pair.first;
-        }
+    // Replace the loaded users and rebuild the table and indexes over them
+    void load(vector<User> loaded) {
+        users = move(loaded);
+        rebuild();
     }
 
-    return mostCommonGenre;
-}
-
-// Function to find average watch time by country
-map<string, double> findAverageWatchTimeByCountry(const vector<User>& users) {
-    map<string, double> totalWatchTime;
-    map<string, int> countryCounts;
-
-    for (const auto& user : users) {
-        totalWatchTime[user.country] += user.watchTime;
-        countryCounts[user.country]++;
+    // Add users after the loaded ones
+    void append(const vector<User>& more) {
+        users.insert(users.end(), more.begin(), more.end());
+        rebuild();
     }
 
-    map<string, double> avgWatchTime;
-    for (const auto& pair : totalWatchTime) {
-        avgWatchTime[pair.first] = pair.second / countryCounts[pair.first];
+private:
+    void rebuild() {
+        table = buildUserTable(users);
+        index = buildUserIndex(table);
+        cache.invalidate(++version);
     }
-
-    return avgWatchTime;
+};
+
+// Ways option 8 can find the most active users
+enum class ActiveMethod { Heap, Graph, ParallelHeap, Index };
+
+// heap, graph, parallel or index; throws invalid_argument for anything else
+ActiveMethod parseActiveMethod(const string& name) {
+    if (name == "heap") return ActiveMethod::Heap;
+    if (name == "graph") return ActiveMethod::Graph;
+    if (name == "parallel") return ActiveMethod::ParallelHeap;
+    if (name == "index") return ActiveMethod::Index;
+    throw invalid_argument("Unknown method " + name + " (expected heap, graph, parallel or index)");
 }
 
-// Optimized function to build graph of user relationships based on genre preferences
-Graph buildUserGenreGraph(const vector<User>& users) {
-    Graph graph;
-
-    // Create vertices for each unique genre
-    map<string, bool> genres;
-    for (const auto& user : users) {
-        genres[user.genre] = true;
+string activeMethodDescription(ActiveMethod method) {
+    switch (method) {
+    case ActiveMethod::Heap:         return "a Min Heap";
+    case ActiveMethod::Graph:        return "a Graph";
+    case ActiveMethod::ParallelHeap: return "thread-local Min Heaps";
+    case ActiveMethod::Index:        return "the sorted watch-time index";
     }
+    return "";
+}
 
-    for (const auto& genre : genres) {
-        graph.addVertex(genre.first);
+// The k most active users (option 8), most active first
+vector<User> findActiveUsers(const Session& session, int k, ActiveMethod method) {
+    const vector<User>& users = session.users;
+    vector<User> activeUsers;
+
+    switch (method) {
+    case ActiveMethod::Heap:
+        activeUsers = findMostActiveUsers(users, k);
+        break;
+    case ActiveMethod::ParallelHeap:
+        activeUsers = findMostActiveUsersParallel(users, k);
+        break;
+    case ActiveMethod::Index: {
+        /* The index is already ordered by watch time, so the top k is its last k entries */
+        vector<uint32_t> rows = session.index.byWatchTime.top(k < 0 ? 0 : k);
+        activeUsers.reserve(rows.size());
+        for (uint32_t row : rows)
+           { activeUsers.push_back(users[row]); }
+        break;
     }
-
-    // Track which genre pairs we've already connected to avoid duplicates
-    map<pair<string, string>, bool> connectedPairs;
-
-    // Create meaningful connections between genres
-    // We'll connect genres that have users with significant similarities
-    for (size_t i = 0; i < users.size() && i < 100; i++) {  // Limit to first 100 users for performance
-        for (size_t j = i + 1; j < users.size() && j < 100; j++) {  // Limit to first 100 users
-            // Only connect different genres
-            if (users[i].genre != users[j].genre) {
-                // Sort genre names to create consistent key
-                string genre1 = users[i].genre;
-                string genre2 = users[j].genre;
-                if (genre1 > genre2) {
-                    swap(genre1, genre2);
-                }
-
-                // Check if we've already connected these genres
-                pair<string, string> genrePair = {genre1, genre2};
-                if (!connectedPairs[genrePair]) {
-                    // Calculate similarity between users
-                    double similarity = calculateSimilarity(users[i], users[j]);
-
-                    // Only connect if there's meaningful similarity (threshold of 70)
-                    if (similarity > 70.0) {
-                        graph.addEdge(genre1, genre2);
-                        connectedPairs[genrePair] = true;
-                    }
-                }
-            }
-        }
+    case ActiveMethod::Graph:
+        activeUsers = findMostActiveUsersByGraph(users, k);
+        break;
     }
 
-    return graph;
+    return activeUsers;
 }
 
-using json = nlohmann::json;
-// Convert graph into a json object
-json toJson(const Graph& graph) {
-    json j;
-    j["nodes"] = json::array();
-    j["edges"] = json::array();
+// Approximate memory held by cached results: the objects and the heap blocks they own
+size_t cacheBytes(const User& user) {
+    return sizeof(User) + user.name.capacity() + user.country.capacity() + user.subscription.capacity()
+         + user.genre.capacity() + user.lastLogin.capacity();
+}
 
-    for (auto const& kv : graph.getAdjList()) {
-        j["nodes"].push_back({
-            {"id",    kv.first},
-            {"label", kv.first}
-        });
-    }
+size_t cacheBytes(const vector<User>& users) {
+    size_t bytes = sizeof(users);
+    for (const auto& user : users) bytes += cacheBytes(user);
+    return bytes;
+}
 
-    set<pair<string,string>> seen;
-    for (auto const& kv : graph.getAdjList()) {
-        for (auto const& nbr : kv.second) {
-            auto p = minmax(kv.first, nbr);
-            if (seen.insert(p).second) {
-                j["edges"].push_back({
-                    {"from", kv.first},
-                    {"to",   nbr}
-                });
-            }
-        }
-    }
+// The analyses through the session's cache: computed on the first request for these arguments on the current
+// data, shared after that
+shared_ptr<const vector<UserSimilarity>> cachedSimilarUsers(const Session& session, unsigned int k) {
+    return session.cache.get("similar", to_string(k), session.version,
+        [&]() {
+            MemoryScope memory("findMostSimilarUsers");
+            return findMostSimilarUsers(session.users, k);
+        },
+        [](const vector<UserSimilarity>& sims) { return sizeof(sims) + sims.capacity() * sizeof(UserSimilarity); });
+}
 
-    return j;
+shared_ptr<const vector<User>> cachedActiveUsers(const Session& session, int k, ActiveMethod method) {
+    return session.cache.get("active", to_string(k) + "/" + activeMethodDescription(method), session.version,
+        [&]() { return findActiveUsers(session, k, method); },
+        [](const vector<User>& users) { return cacheBytes(users); });
 }
 
-void exportGraphToJson(const Graph& graph, const string& filepath) {
-    json j = toJson(graph);
-    ofstream ofs(filepath);
-    ofs << j.dump(2) << endl;
+shared_ptr<const RowBitmap> cachedUsersBySubscription(const Session& session, const string& subType) {
+    return session.cache.get("subscription", subType, session.version,
+        [&]() { return findUsersBySubscription(session.table, session.index.bitmaps, subType); },
+        [](const RowBitmap& rows) { return rows.memoryBytes(); });
 }
 
+shared_ptr<const vector<pair<string, string>>> cachedGenreByAgeGroup(const Session& session) {
+    return session.cache.get("age-genre", "", session.version,
+        [&]() {
+            // One scan fills the whole [age][genre] histogram; every group (15-20, 20-25, ...) is read from it
+            return genreByAgeGroup(buildAgeGenreHistogram(session.table), session.table.genres);
+        },
+        [](const vector<pair<string, string>>& groups) {
+            size_t bytes = sizeof(groups);
+            for (const auto& [range, genre] : groups) bytes += sizeof(range) * 2 + range.capacity() + genre.capacity();
+            return bytes;
+        });
+}
 
-// Optimized function to find most similar users
-vector<UserSimilarity> findMostSimilarUsers(const vector<User>& users, unsigned int k) {
-    // Limit the number of user comparisons for better performance
-    const size_t MAX_USERS = 100;  // Limit to first 100 users
+shared_ptr<const map<string, double>> cachedAverageWatchTime(const Session& session) {
+    return session.cache.get("country-avg", "", session.version,
+        [&]() { return findAverageWatchTimeByCountry(session.table); },
+        [](const map<string, double>& averages) {
+            size_t bytes = sizeof(averages);
+            for (const auto& [country, hours] : averages) bytes += 64 + country.capacity();   // tree node overhead
+            return bytes;
+        });
+}
 
-    // Create a vector for the top k similar pairs
-    vector<UserSimilarity> topSimilarities;
-    double lowestSimilarityInTop = -1.0;  // Keep track of the lowest similarity in our top k
+shared_ptr<const Graph> cachedGenreGraph(const Session& session) {
+    return session.cache.get("graph", "", session.version,
+        [&]() {
+            MemoryScope memory("buildUserGenreGraph");
+            return buildUserGenreGraph(session.users);
+        },
+        [](const Graph& graph) {
+            size_t bytes = sizeof(graph);
+            for (const auto& [genre, neighbours] : graph.getAdjList()) {
+                bytes += 64 + genre.capacity();
+                for (const auto& n : neighbours) bytes += sizeof(n) + n.capacity();
+            }
+            return bytes;
+        });
+}
 
-    // Calculate similarity only for a reasonable number of users
-    for (size_t i = 0; i < users.size() && i < MAX_USERS; i++) {
-        for (size_t j = i + 1; j < users.size() && j < MAX_USERS; j++) {
-            double similarityScore = calculateSimilarity(users[i], users[j]);
+shared_ptr<const RecencyScan> cachedRecency(const Session& session, const vector<unsigned int>& windows) {
+    string key;
+    for (unsigned int days : windows) key += to_string(days) + ",";
+    return session.cache.get("recency", key, session.version,
+        [&]() { return scanRecency(session.table, windows); },
+        [](const RecencyScan& scan) {
+            size_t bytes = sizeof(scan) + scan.windows.capacity() * sizeof(unsigned int)
+                         + (scan.activeWithin.capacity() + scan.countryMonths.capacity() + scan.genreMonths.capacity()
+                            + scan.churnRisk.capacity()) * sizeof(uint64_t);
+            for (const auto& month : scan.months) bytes += sizeof(month) + month.capacity();
+            return bytes;
+        });
+}
 
-            // Only process this pair if it might be in the top k
-            if (topSimilarities.size() < k || similarityScore > lowestSimilarityInTop) {
-                UserSimilarity similarity;
-                similarity.user1ID = users[i].userID;
-                similarity.user2ID = users[j].userID;
-                similarity.similarity = similarityScore;
 
-                // Add to our collection
-                topSimilarities.push_back(similarity);
+// Most common genre of each age group (option 3), exported to genreForAgeGroup.json
+vector<pair<string, string>> exportGenreByAgeGroup(Session& session) {
+    vector<pair<string, string>> groups = *cachedGenreByAgeGroup(session);
 
-                // If we exceed k elements, remove the lowest and update lowestSimilarityInTop
-                if (topSimilarities.size() > k) {
-                    // Find the index of the minimum similarity
-                    int minIndex = 0;
-                    for (size_t idx = 1; idx < topSimilarities.size(); idx++) {
-                        if (topSimilarities[idx].similarity < topSimilarities[minIndex].similarity) {
-                            minIndex = idx;
-                        }
-                    }
+    // Write the whole array once, leaving out the empty groups
+    MemoryScope memory("export");
+    session.exporter.write(DATA_DIR + "genreForAgeGroup.json",
+        [&](JsonWriter& writer) { writeGenreByAgeGroup(writer, groups); });
+    return groups;
+}
 
-                    // Remove the lowest similarity from our collection
-                    lowestSimilarityInTop = topSimilarities[minIndex].similarity;
-                    topSimilarities.erase(topSimilarities.begin() + minIndex);
+// Average watch time of each country (option 4), exported to avgWatchTimeByCountry.json
+map<string, double> exportAverageWatchTime(Session& session) {
+    map<string, double> avgWatchTime = *cachedAverageWatchTime(session);
+    MemoryScope memory("export");
+    session.exporter.write(DATA_DIR + "avgWatchTimeByCountry.json",
+        [&](JsonWriter& writer) { writeAverageWatchTime(writer, avgWatchTime); });
+    return avgWatchTime;
+}
 
-                    // Update the lowest similarity in our collection
-                    lowestSimilarityInTop = numeric_limits<double>::max();
-                    for (const auto& sim : topSimilarities) {
-                        if (sim.similarity < lowestSimilarityInTop) {
-                            lowestSimilarityInTop = sim.similarity;
-                        }
-                    }
-                }
-            }
-        }
-    }
+// Genre relationship graph (option 5), exported to genre_graph.json for the frontend visualization
+Graph exportGenreGraph(Session& session) {
+    Graph graph = *cachedGenreGraph(session);
+    exportGraphToJson(graph, DATA_DIR + "genre_graph.json", session.exporter);
+    return graph;
+}
 
-    // Sort the final results in descending order of similarity
-    sort(topSimilarities.begin(), topSimilarities.end(),
-         [](const UserSimilarity& a, const UserSimilarity& b) {
-             return a.similarity > b.similarity;
-         });
+// The k most similar user pairs (option 6), exported to similar_users.json
+vector<UserSimilarity> exportSimilarUsers(Session& session, unsigned int k) {
+    vector<UserSimilarity> similarUsers = *cachedSimilarUsers(session, k);
+    writeSimilaritiesToJSON(similarUsers, session.users, session.table, session.index.byUserID,
+                            DATA_DIR + "similar_users.json", session.exporter);
+    return similarUsers;
+}
 
-    return topSimilarities;
+// Users on one subscription plan (option 7), exported to <plan>_users.json
+RowBitmap exportUsersBySubscription(Session& session, const string& subType) {
+    RowBitmap rows = *cachedUsersBySubscription(session, subType);
+    MemoryScope memory("export");
+    session.exporter.writeUserList(DATA_DIR + subType + "_users.json", session.users, rows);
+    return rows;
 }
 
-void writeSimilaritiesToJSON(const vector<UserSimilarity>& sims,
-                             const filesystem::path& filePath)
-{
-    namespace fs = filesystem;
-    using nlohmann::json;
+void exportActiveUsers(Session& session, const vector<User>& activeUsers) {
+    MemoryScope memory("export");
+    session.exporter.write(DATA_DIR + "topActive_users.json",
+        [&](JsonWriter& writer) { writeUsers(writer, activeUsers); });
+}
 
-    fs::create_directories(filePath.parent_path());
+// Login recency and churn risk (option 14) over the given windows of days, exported to recency.json
+RecencyScan exportRecency(Session& session, const vector<unsigned int>& windows) {
+    RecencyScan scan = *cachedRecency(session, windows);
+    MemoryScope memory("export");
+    session.exporter.write(DATA_DIR + "recency.json",
+        [&](JsonWriter& writer) { writeRecency(writer, scan, session.table); });
+    return scan;
+}
 
-    json j = json::array();
-    for (const auto& s : sims) {
-        j.push_back({
-            {"user1ID",    s.user1ID},
-            {"user2ID",    s.user2ID},
-            {"similarity", s.similarity}
+// Every view in one bundle (option 13), exported to dashboard.json, with the time each stage took
+bool exportDashboard(Session& session, unsigned int similarK, unsigned int activeK) {
+    // One scan of the table feeds every user aggregate, one of the date column the recency figures; only the
+    // similarity stage looks at the users again
+    auto scanStart = chrono::high_resolution_clock::now();
+    DashboardScan scan = scanDashboard(session.table, activeK);
+    RecencyScan recency = scanRecency(session.table);
+    auto similarStart = chrono::high_resolution_clock::now();
+    vector<UserSimilarity> similarUsers;
+    {
+        MemoryScope memory("findMostSimilarUsers");
+        similarUsers = findMostSimilarUsers(session.users, similarK);
+    }
+    auto writeStart = chrono::high_resolution_clock::now();
+    const string bundlePath = DATA_DIR + "dashboard.json";
+    bool written;
+    {
+        MemoryScope memory("export");
+        written = session.exporter.write(bundlePath, [&](JsonWriter& writer) {
+            writeDashboard(writer, scan, recency, similarUsers, session.users, session.table, session.index.byUserID);
         });
     }
-
-    ofstream out(filePath);
-    if (!out) {
-        cerr << "Cannot write to " << fs::absolute(filePath) << '\n';
-        return;
+    auto writeFinish = chrono::high_resolution_clock::now();
+
+    if (written) {
+        auto us = [](auto from, auto to) { return chrono::duration_cast<chrono::microseconds>(to - from).count(); };
+        cout << "Wrote dashboard bundle v" << DASHBOARD_BUNDLE_VERSION << " → "
+             << filesystem::absolute(session.exporter.pathFor(bundlePath)) << '\n'
+             << "Scan " << us(scanStart, similarStart) << " μs, similarity " << us(similarStart, writeStart)
+             << " μs, write " << us(writeStart, writeFinish) << " μs." << endl;
     }
-    out << j.dump(2);
-    cout << "Wrote " << sims.size() << " pairs → "
-              << fs::absolute(filePath) << '\n';
+    return written;
 }
 
-// Find users by subscription type
-vector<User> findUsersBySubscription(const vector<User>& users, const string& subscriptionType) {
-    vector<User> result;
+// Display Menu
+void displayMenu() {
+    cout << "\n========== Netflix User Data Relationship Analyzer ==========\n";
+    cout << "1. Load user data from CSV file\n";
+    cout << "2. Generate sample data\n";
+    cout << "3. Find most common genre for a specific age group\n";
+    cout << "4. Find average watch time by country\n";
+    cout << "5. Build and display user-genre relationship graph\n";
+    cout << "6. Find most similar users\n";
+    cout << "7. Find users by subscription type\n";
+    cout << "8. Find most active users\n";
+    cout << "9. Display all loaded users\n";
+    cout << "10. Custom breakdown (group by / aggregate)\n";
+    cout << "11. Filter users by subscription, country, genre, age and watch time\n";
+    cout << "12. Choose export format\n";
+    cout << "13. Build dashboard (every view in one bundle file)\n";
+    cout << "14. Login recency and churn risk\n";
+    cout << "0. Exit\n";
+    cout << "=============================================================\n";
+    cout << "Enter your choice: ";
+}
 
-    for (const auto& user : users) {
-        if (user.subscription == subscriptionType) {
-            result.push_back(user);
-        }
+// A count given on the command line or in a query string; throws invalid_argument if it is not a number
+unsigned long parseCount(const string& name, const string& value) {
+    try {
+        return stoul(value);
+    }
+    catch (const logic_error&) {
+        throw invalid_argument(name + " expects a number, got " + value);
     }
-
-    return result;
 }
 
-nlohmann::json usersToJson(const vector<User>& users)
-{
-    using nlohmann::json;
-
-    json arr = json::array();
-    for (const auto& u : users)
-        arr.push_back({
-            {"userID",    u.userID},
-            {"name",      u.name},
-            {"age",       u.age},
-            {"country",   u.country},
-            {"subscription", u.subscription},
-            {"watchTime", u.watchTime},
-            {"genre",     u.genre},
-            {"lastLogin", u.lastLogin}
-        });
-
-    return arr;        // e.g. [ {…}, {…}, … ]
+// Windows of days for the recency analysis: "7,30,90"
+vector<unsigned int> parseWindows(const string& name, const string& value) {
+    vector<unsigned int> windows;
+    stringstream list(value);
+    for (string days; getline(list, days, ',');) windows.push_back((unsigned int)parseCount(name, days));
+    if (windows.empty()) throw invalid_argument(name + " needs at least one number of days");
+    return windows;
 }
 
-bool writeJsonToFile(const nlohmann::json& j,
-                     const filesystem::path& filePath,
-                     int indent = 2)      
-{
-    namespace fs = filesystem;
-    fs::create_directories(filePath.parent_path());   
+// The recency figures on the console: how many users are in each window and churn-risk bucket
+void printRecency(const RecencyScan& scan, const UserTable& table) {
+    if (scan.referenceDay == NO_DAY) {
+        cout << "No user has a login date." << endl;
+        return;
+    }
 
-    ofstream out(filePath);
-    if (!out) {
-        cerr << "Cannot open " << fs::absolute(filePath) << '\n';
-        return false;
+    cout << "Logins counted back from " << civilFromDays(scan.referenceDay) << ", over " << scan.months.size()
+         << " months:\n";
+    for (size_t w = 0; w < scan.windows.size(); ++w)
+        cout << "  active in the last " << setw(4) << scan.windows[w] << " days: " << scan.activeWithin[w] << "\n";
+    if (scan.undated > 0) cout << "  without a login date: " << scan.undated << "\n";
+
+    cout << "Churn risk:\n";
+    cout << "  " << left << setw(12) << "plan" << right;
+    for (const char* bucket : CHURN_BUCKET_NAMES) cout << setw(10) << bucket;
+    cout << "\n";
+    for (unsigned int plan = 0; plan < table.subscriptions.size(); ++plan) {
+        cout << "  " << left << setw(12) << table.subscriptions.decode(plan) << right;
+        for (unsigned int bucket = 0; bucket < CHURN_BUCKETS; ++bucket)
+            cout << setw(10) << scan.churnRisk[plan * CHURN_BUCKETS + bucket];
+        cout << "\n";
     }
-    out << j.dump(indent);
-    return true;
+    cout << flush;
 }
 
+// The server 'serve' is running, for the signal handler to stop
+HttpServer* runningServer = nullptr;
 
-// Find most active users (Min Fixed Size Heap)
-vector<User> findMostActiveUsers(const vector<User>& users, int k) 
-{
-    FixedMinHeap<UserWatch> heap(k);
-
-    for (auto& u : users)
-    { 
-        UserWatch uw{ u.watchTime, u };
-        heap.insert(uw);
-    }
+extern "C" void stopRunningServer(int) {
+    if (runningServer) runningServer->stop();
+}
 
-    vector<User> result;
-    vector<UserWatch> buf;
-    while (heap.empty() == false) 
-    {
-        buf.push_back(heap.getMin());
-        heap.removeMin();
+// The analyses as live JSON endpoints over the loaded data. Nothing is written to disk; the responses have
+// the same layout as the export files.
+void addRoutes(HttpServer& server, const Session& session) {
+    auto count = [](const HttpRequest& request, const string& name, unsigned long fallback) {
+        string value = request.param(name);
+        return value.empty() ? fallback : parseCount(name, value);
+    };
+
+    server.route("/age-genre", [&session](const HttpRequest&) {
+        auto groups = cachedGenreByAgeGroup(session);
+        return HttpResponse::json([&](JsonWriter& writer) { writeGenreByAgeGroup(writer, *groups); });
+    });
+    server.route("/country-avg", [&session](const HttpRequest&) {
+        auto averages = cachedAverageWatchTime(session);
+        return HttpResponse::json([&](JsonWriter& writer) { writeAverageWatchTime(writer, *averages); });
+    });
+    server.route("/graph", [&session](const HttpRequest&) {
+        auto graph = cachedGenreGraph(session);
+        return HttpResponse::json([&](JsonWriter& writer) { writeGraph(writer, *graph); });
+    });
+    // ?k=10
+    server.route("/similar", [&session, count](const HttpRequest& request) {
+        auto sims = cachedSimilarUsers(session, count(request, "k", 10));
+        return HttpResponse::json([&](JsonWriter& writer) {
+            writeSimilarities(writer, *sims, session.users, session.table, session.index.byUserID);
+        });
+    });
+    // ?k=10&method=heap|graph|parallel|index
+    server.route("/active", [&session, count](const HttpRequest& request) {
+        ActiveMethod method = parseActiveMethod(request.param("method", "heap"));
+        auto activeUsers = cachedActiveUsers(session, (int)count(request, "k", 10), method);
+        return HttpResponse::json([&](JsonWriter& writer) { writeUsers(writer, *activeUsers); });
+    });
+    // ?subscription=Premium&offset=0&limit=100, every user on the plan without a limit
+    server.route("/users", [&session, count](const HttpRequest& request) {
+        string subType = request.param("subscription");
+        if (subType.empty()) throw invalid_argument("subscription is required");
+
+        // Only the requested page is expanded into row ids; without offset or limit the bitmap is written as it is
+        auto rows = cachedUsersBySubscription(session, subType);
+        if (request.param("offset").empty() && request.param("limit").empty())
+            return HttpResponse::json([&](JsonWriter& writer) { writeUsers(writer, session.users, *rows); });
+
+        vector<uint32_t> page = rows->toRows(count(request, "offset", 0), count(request, "limit", UINT32_MAX));
+        return HttpResponse::json([&](JsonWriter& writer) { writeUsers(writer, session.users, page); });
+    });
+    // ?similar=10&active=10
+    server.route("/dashboard", [&session, count](const HttpRequest& request) {
+        DashboardScan scan = scanDashboard(session.table, count(request, "active", 10));
+        auto recency = cachedRecency(session, { 7, 30, 90 });
+        auto sims = cachedSimilarUsers(session, count(request, "similar", 10));
+        return HttpResponse::json([&](JsonWriter& writer) {
+            writeDashboard(writer, scan, *recency, *sims, session.users, session.table, session.index.byUserID);
+        });
+    });
+    // ?days=7,30,90
+    server.route("/recency", [&session](const HttpRequest& request) {
+        auto scan = cachedRecency(session, parseWindows("days", request.param("days", "7,30,90")));
+        return HttpResponse::json([&](JsonWriter& writer) { writeRecency(writer, *scan, session.table); });
+    });
+    server.route("/cache", [&session](const HttpRequest&) {
+        return HttpResponse::json([&](JsonWriter& writer) { session.cache.writeStats(writer); });
+    });
+}
 
-    }
+// Usage of the batch mode
+void printUsage(ostream& out) {
+    out << "Usage: FlixHabit [--trace <file.json>] [--memory]  interactive menu\n"
+           "       FlixHabit [--trace <file.json>] [--memory] <command> [<command> ...]\n"
+           "--trace records where the run spends its time into a Chrome trace file and prints a summary\n"
+           "per phase at the end. --memory counts the allocations, heap and resident-set peaks of every\n"
+           "command (or menu option), the analyses and exports inside it, and prints them at the end.\n"
+           "Commands run in order against the data loaded by the last load (or sample):\n"
+           "  load <file.csv>                    load users; a bare name is looked up in ../data/\n"
+           "  append <file.csv>                  add the users of another file to the loaded ones\n"
+           "  sample                             generate the sample users\n"
+           "  generate <N> [--seed S] [--csv <file>]\n"
+           "                                     N synthetic users shaped like netflix_users.csv, the same for the\n"
+           "                                     same seed (default 1); with --csv streamed to the file instead of loaded\n"
+           "  format <name> [--gzip y|n] [--page-size N]\n"
+           "                                     export format (json, compact, ndjson, cbor, msgpack), as in option 12\n"
+           "  age-genre                          most common genre per age group\n"
+           "  country-avg                        average watch time by country\n"
+           "  graph                              user-genre relationship graph\n"
+           "  similar [--k N]                    N most similar user pairs (default 10)\n"
+           "  active [--k N] [--method heap|graph|parallel|index]\n"
+           "                                     N most active users (default 10, heap)\n"
+           "  by-subscription <plan>             users on one plan\n"
+           "  dashboard [--similar N] [--active N]\n"
+           "                                     every view in one bundle file\n"
+           "  recency [--days 7,30,90]           users active within each number of days of the latest login,\n"
+           "                                     logins per month by country and genre, churn risk per plan\n"
+           "  serve [--port N] [--threads N] [--cache-mb N]\n"
+           "                                     answer the analyses as JSON on http://127.0.0.1:N (default 8080)\n"
+           "                                     until interrupted; GET /stats shows per-endpoint latencies,\n"
+           "                                     GET /cache the result cache (default 64 MB)\n"
+           "Repeated analyses on unchanged data are answered from a result cache; its hits and misses are\n"
+           "printed at the end.\n"
+           "Each command prints one line: its name, how long it took and what it produced.\n";
+}
 
-    reverse(buf.begin(), buf.end());
+// One command of a batch with the arguments up to the next command
+struct BatchCommand {
+    string name;
+    vector<string> positional;
+    map<string, string> options;       // "--k 10" -> options["k"] = "10"
 
-    for (auto& uw : buf)
-       { result.push_back(uw.user); }
+    // The option's value as a number, 'fallback' when it was not given
+    unsigned long number(const string& option, unsigned long fallback) const {
+        auto it = options.find(option);
+        return it == options.end() ? fallback : parseCount("--" + option, it->second);
+    }
+};
+
+// Split the arguments into commands; throws invalid_argument for unknown commands or options and for values
+// that cannot be used, so a bad command line is caught before anything runs
+vector<BatchCommand> parseBatch(const vector<string>& args) {
+    // Each command with the options it accepts and how many positional arguments it needs
+    const map<string, pair<set<string>, size_t>> commands = {
+        { "load",            { {}, 1 } },
+        { "append",          { {}, 1 } },
+        { "sample",          { {}, 0 } },
+        { "generate",        { { "seed", "csv" }, 1 } },
+        { "format",          { { "gzip", "page-size" }, 1 } },
+        { "age-genre",       { {}, 0 } },
+        { "country-avg",     { {}, 0 } },
+        { "graph",           { {}, 0 } },
+        { "similar",         { { "k" }, 0 } },
+        { "active",          { { "k", "method" }, 0 } },
+        { "by-subscription", { {}, 1 } },
+        { "dashboard",       { { "similar", "active" }, 0 } },
+        { "recency",         { { "days" }, 0 } },
+        { "serve",           { { "port", "threads", "cache-mb" }, 0 } },
+    };
+
+    vector<BatchCommand> batch;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const string& arg = args[i];
+        if (commands.count(arg)) {
+            batch.push_back({ arg, {}, {} });
+            continue;
+        }
+        if (batch.empty()) throw invalid_argument("Unknown command " + arg);
+
+        BatchCommand& command = batch.back();
+        if (arg.rfind("--", 0) == 0) {
+            string option = arg.substr(2);
+            if (commands.at(command.name).first.count(option) == 0)
+                throw invalid_argument(command.name + " has no option " + arg);
+            if (i + 1 >= args.size()) throw invalid_argument(arg + " needs a value");
+            command.options[option] = args[++i];
+        }
+        else {
+            command.positional.push_back(arg);
+        }
+    }
 
-    return result;
+    for (const auto& command : batch) {
+        size_t expected = commands.at(command.name).second;
+        if (command.positional.size() != expected)
+            throw invalid_argument(command.name + " takes " + to_string(expected) + " argument(s), got "
+                                   + to_string(command.positional.size()));
+
+        for (const auto& [option, value] : command.options) {
+            if (option == "method") parseActiveMethod(value);
+            else if (option == "days") parseWindows("--days", value);
+            else if (option == "gzip") {
+                if (value != "y" && value != "yes" && value != "n" && value != "no")
+                    throw invalid_argument("--gzip expects y or n, got " + value);
+            }
+            else if (option != "csv") parseCount("--" + option, value);
+        }
+        if (command.name == "generate") parseCount("N", command.positional[0]);
+        if (command.name == "format") parseExportFormat(command.positional[0]);
+        if (command.name == "serve" && command.number("port", 8080) > 65535)
+            throw invalid_argument("--port must be below 65536");
+    }
+    return batch;
 }
 
-// Generate sample data for testing
-vector<User> generateSampleData() {
-    vector<User> users;
+// Batch mode: run the commands in order in this one process, so the data is loaded once however many
+// analyses follow, e.g.  FlixHabit load netflix_users.csv similar --k 10 active --k 20 --method graph
+// Returns the exit status: 0 on success, 1 if a command failed, 2 for a bad command line.
+int runBatch(Session& session, const vector<string>& args) {
+    if (args.size() == 1 && (args[0] == "--help" || args[0] == "-h")) {
+        printUsage(cout);
+        return 0;
+    }
 
-    // Sample user data
-    string genres[] = { "Comedy", "Drama", "Action", "Horror", "Romance", "Documentary" };
-    string countries[] = { "USA", "Canada", "UK", "France", "Germany", "Japan" };
-    string subscriptions[] = { "Basic", "Standard", "Premium" };
+    vector<BatchCommand> batch;
+    try {
+        batch = parseBatch(args);
+    }
+    catch (const invalid_argument& e) {
+        cerr << e.what() << "\n\n";
+        printUsage(cerr);
+        return 2;
+    }
 
-    for (int i = 1; i <= 20; i++) {
-        User user;
-        user.userID = i;
-        user.name = "User" + to_string(i);
-        user.age = 18 + (i % 40); // Ages from 18 to 57
-        user.country = countries[i % 6];
-        user.subscription = subscriptions[i % 3];
-        user.watchTime = 10.0 + (i * 2.5); // Different watch times
-        user.genre = genres[i % 6];
-        user.lastLogin = "2023-04-" + (i < 10 ? "0" + to_string(i) : to_string(i));
+    auto batchStart = chrono::high_resolution_clock::now();
+    for (const auto& command : batch) {
+        if (session.users.empty() && command.name != "load" && command.name != "append" && command.name != "sample"
+            && command.name != "generate" && command.name != "format") {
+            cerr << command.name << ": no user data loaded; start with load or sample" << endl;
+            return 1;
+        }
 
-        users.push_back(user);
-    }
+        string summary;
+        MemoryScope memory(command.name);
+        auto start = chrono::high_resolution_clock::now();
+        try {
+            const string& name = command.name;
+            if (name == "load" || name == "append") {
+                // Same lookup as option 1 for a bare file name, but a path that exists is taken as it is
+                string path = command.positional[0];
+                if (!filesystem::exists(path)) path = "../data/" + path;
+                vector<User> loaded = readUsersFromCSV(path);
+                if (loaded.empty()) {
+                    cerr << name << ": no users read from " << path << endl;
+                    return 1;
+                }
+                summary = to_string(loaded.size()) + " users from " + path;
+                if (name == "load") session.load(move(loaded));
+                else session.append(loaded);
+                if (name == "append") summary += ", " + to_string(session.users.size()) + " in all";
+            }
+            else if (name == "sample") {
+                session.load(generateSampleData());
+                summary = to_string(session.users.size()) + " sample users";
+            }
+            else if (name == "generate") {
+                size_t count = parseCount("N", command.positional[0]);
+                SyntheticUsers generator(SyntheticProfile::netflixUsers(), command.number("seed", 1));
+                auto csv = command.options.find("csv");
+                if (csv != command.options.end()) {
+                    ofstream out(csv->second, ios::binary);
+                    if (!out.is_open() || !generator.writeCsv(out, count)) {
+                        cerr << name << ": cannot write " << csv->second << endl;
+                        return 1;
+                    }
+                    summary = to_string(count) + " synthetic users written to " + csv->second;
+                }
+                else {
+                    session.load(generator.generate(count));
+                    summary = to_string(count) + " synthetic users";
+                }
+            }
+            else if (name == "format") {
+                Exporter& exporter = session.exporter;
+                exporter.format = parseExportFormat(command.positional[0]);
+                auto gzip = command.options.find("gzip");
+                if (gzip != command.options.end())
+                    exporter.compressor = gzip->second == "y" || gzip->second == "yes" ? &session.compressor : nullptr;
+                exporter.pageSize = command.number("page-size", exporter.pageSize);
+                summary = exportFormatName(exporter.format) + (exporter.compressor ? " with .gz copies" : "")
+                        + (exporter.pageSize > 0 ? ", pages of " + to_string(exporter.pageSize) + " users" : "");
+            }
+            else if (name == "age-genre") {
+                auto groups = exportGenreByAgeGroup(session);
+                summary = to_string(groups.size()) + " age groups";
+            }
+            else if (name == "country-avg") {
+                summary = to_string(exportAverageWatchTime(session).size()) + " countries";
+            }
+            else if (name == "graph") {
+                Graph graph = exportGenreGraph(session);
+                summary = to_string(graph.getAdjList().size()) + " genres";
+            }
+            else if (name == "similar") {
+                summary = to_string(exportSimilarUsers(session, command.number("k", 10)).size()) + " pairs";
+            }
+            else if (name == "active") {
+                auto method = command.options.count("method") ? parseActiveMethod(command.options.at("method"))
+                                                              : ActiveMethod::Heap;
+                auto activeUsers = cachedActiveUsers(session, (int)command.number("k", 10), method);
+                exportActiveUsers(session, *activeUsers);
+                summary = to_string(activeUsers->size()) + " users using " + activeMethodDescription(method);
+            }
+            else if (name == "by-subscription") {
+                RowBitmap rows = exportUsersBySubscription(session, command.positional[0]);
+                summary = to_string(rows.cardinality()) + " " + command.positional[0] + " users";
+            }
+            else if (name == "serve") {
+                unsigned long port = command.number("port", 8080);
+                session.cache.setBudget(command.number("cache-mb", 64) << 20);
+                HttpServer server((unsigned int)command.number("threads", 0));
+                addRoutes(server, session);
+                server.listen("127.0.0.1", (uint16_t)port);
+
+                runningServer = &server;
+                auto previousInt = signal(SIGINT, stopRunningServer);
+                auto previousTerm = signal(SIGTERM, stopRunningServer);
+                cout << "Serving " << session.users.size() << " users on http://127.0.0.1:" << server.getPort()
+                     << "/ (Ctrl+C to stop)" << endl;
+                server.run();
+                signal(SIGINT, previousInt);
+                signal(SIGTERM, previousTerm);
+                runningServer = nullptr;
+
+                ostringstream stats;
+                {
+                    JsonWriter writer(stats, ExportFormat::CompactJson);
+                    server.writeStats(writer);
+                }
+                summary = stats.str();
+            }
+            else if (name == "recency") {
+                auto days = command.options.find("days");
+                RecencyScan scan = exportRecency(session, parseWindows("--days", days == command.options.end()
+                                                                                  ? "7,30,90" : days->second));
+                summary = "within " + to_string(scan.windows.front()) + " days: "
+                        + to_string(scan.activeWithin.front()) + " users";
+            }
+            else if (name == "dashboard") {
+                if (!exportDashboard(session, command.number("similar", 10), command.number("active", 10))) return 1;
+                summary = "bundle v" + to_string(DASHBOARD_BUNDLE_VERSION);
+            }
+        }
+        catch (const exception& e) {
+            // The command line was checked up front, so whatever goes wrong now is the command failing
+            cerr << command.name << ": " << e.what() << endl;
+            return 1;
+        }
+        auto finish = chrono::high_resolution_clock::now();
 
-    return users;
-}
+        cout << left << setw(18) << command.name << right << setw(12)
+             << chrono::duration_cast<chrono::microseconds>(finish - start).count() << " μs  " << summary << endl;
+    }
 
-// Display Menu
-void displayMenu() {
-    cout << "\n========== Netflix User Data Relationship Analyzer ==========\n";
-    cout << "1. Load user data from CSV file\n";
-    cout << "2. Generate sample data\n";
-    cout << "3. Find most common genre for a specific age group\n";
-    cout << "4. Find average watch time by country\n";
-    cout << "5. Build and display user-genre relationship graph\n";
-    cout << "6. Find most similar users\n";
-    cout << "7. Find users by subscription type\n";
-    cout << "8. Find most active users\n";
-    cout << "9. Display all loaded users\n";
-    cout << "0. Exit\n";
-    cout << "=============================================================\n";
-    cout << "Enter your choice: ";
+    // The .gz copies are part of the output, so wait for them before reporting the total
+    session.compressor.wait();
+    auto batchFinish = chrono::high_resolution_clock::now();
+    cout << left << setw(18) << "total" << right << setw(12)
+         << chrono::duration_cast<chrono::microseconds>(batchFinish - batchStart).count() << " μs  "
+         << batch.size() << " commands" << endl;
+    const ResultCache& cache = session.cache;
+    if (cache.getHits() + cache.getMisses() > 0) {
+        cout << "Result cache: " << cache.getHits() << " hits, " << cache.getMisses() << " misses, "
+             << cache.getEvictions() << " evictions, " << cache.getEntries() << " results in " << cache.getBytes()
+             << " bytes." << endl;
+    }
+    return 0;
 }
 
-// Main function - entry point for the application
-int main() {
-    vector<User> users;
+// The interactive menu
+int runMenu(Session& session) {
+    const vector<User>& users = session.users;
+    const UserTable& table = session.table;
+    const UserIndex& index = session.index;
+    BackgroundCompressor& compressor = session.compressor;
+    Exporter& exporter = session.exporter;
     int choice;
     string filename;
 
@@ -437,6 +817,7 @@ int main() {
         displayMenu();
         cin >> choice;
         cin.ignore(numeric_limits<streamsize>::max(), '\n'); // Clear input buffer
+        MemoryScope memory("option " + to_string(choice));
 
         switch (choice) {
         case 1: {
@@ -449,12 +830,12 @@ int main() {
             /* User only has to enter the filename */
             string fullPath = dataWD + filename;
 
-            users = readUsersFromCSV(fullPath);
+            session.load(readUsersFromCSV(fullPath));
             cout << "Loaded " << users.size() << " users from " << fullPath << endl;
             break;
         }
         case 2: {
-            users = generateSampleData();
+            session.load(generateSampleData());
             cout << "Generated sample data with " << users.size() << " users." << endl;
             break;
         }
@@ -464,38 +845,8 @@ int main() {
                 break;
             }
 
-            int minAge = 15, maxAge = 80;
-            nlohmann::json buckets = nlohmann::json::array();
-
-            // cout << "Enter minimum age: ";
-            // cin >> minAge;
-            // cout << "Enter maximum age: ";
-            // cin >> maxAge;
-            // cin.ignore(numeric_limits<streamsize>::max(), '\n'); // Clear input buffer
-
-            for (int lo = minAge; lo < maxAge; lo += 5) {
-                int hi = lo + 5;            // 15‑20, 20‑25
-
-                string genre = findMostCommonGenreForAgeGroup(users, lo, hi);
-
-                if (genre.empty()) {
-                    cout << "  " << lo << "-" << hi << ": (no users)\n";
-                    continue;
-                }
-
-                cout << "  " << lo << "-" << hi << ": " << genre << '\n';
-
-                buckets.push_back({
-                    {"ageRange", to_string(lo) + "-" + to_string(hi)},
-                    {"genre",    genre}
-                });
-            }
-
-            // Write the whole array once
-            {
-                filesystem::create_directories("../frontend/public/data");
-                ofstream out("../frontend/flixhabit-frontend/public/data/genreForAgeGroup.json");
-                out << buckets.dump(2);
+            for (const auto& [ageRange, genre] : exportGenreByAgeGroup(session)) {
+                cout << "  " << ageRange << ": " << (genre.empty() ? "(no users)" : genre) << '\n';
             }
             break;
         }
@@ -505,25 +856,12 @@ int main() {
                 break;
             }
 
-            map<string, double> avgWatchTime = findAverageWatchTimeByCountry(users);
+            map<string, double> avgWatchTime = exportAverageWatchTime(session);
             cout << "Average watch time by country:\n";
 
             for (const auto& pair : avgWatchTime) {
                 cout << pair.first << ": " << pair.second << " hours\n";
             }
-
-            nlohmann::json j;
-            for (const auto& [country, hrs] : avgWatchTime)
-                j[country] = hrs;
-
-            // ④ write it once
-            {
-                namespace fs = filesystem;
-                fs::create_directories("../frontend/public/data");
-                ofstream out("../frontend/flixhabit-frontend/public/data/avgWatchTimeByCountry.json");
-                out << j.dump(2);
-            }
-
             break;
         }
         case 5: {
@@ -532,9 +870,7 @@ int main() {
                 break;
             }
 
-            Graph userGenreGraph = buildUserGenreGraph(users);
-            // Export the user-genre graph to JSON for frontend visualization
-            exportGraphToJson(userGenreGraph,"../frontend/flixhabit-frontend/public/data/genre_graph.json");
+            Graph userGenreGraph = exportGenreGraph(session);
             cout << "User-Genre Relationship Graph:\n";
             userGenreGraph.printGraph();
             break;
@@ -550,13 +886,17 @@ int main() {
             cin >> k;
             cin.ignore(numeric_limits<streamsize>::max(), '\n'); // Clear input buffer
 
-            vector<UserSimilarity> similarUsers = findMostSimilarUsers(users, k);
-            writeSimilaritiesToJSON(similarUsers, "../frontend/flixhabit-frontend/public/data/similar_users.json");
+            vector<UserSimilarity> similarUsers = exportSimilarUsers(session, k);
 
             cout << "Most similar users:\n";
             for (const auto& pair : similarUsers) {
-                cout << "User " << pair.user1ID << " and User " << pair.user2ID
-                    << " (Similarity score: " << pair.similarity << ")\n";
+                long long row1 = index.byUserID.find(table, pair.user1ID);
+                long long row2 = index.byUserID.find(table, pair.user2ID);
+                cout << "User " << pair.user1ID;
+                if (row1 >= 0) cout << " (" << users[row1].name << ")";
+                cout << " and User " << pair.user2ID;
+                if (row2 >= 0) cout << " (" << users[row2].name << ")";
+                cout << " (Similarity score: " << pair.similarity << ")\n";
             }
             break;
         }
@@ -570,21 +910,19 @@ int main() {
             cout << "Enter subscription type (Basic, Standard, Premium): ";
             getline(cin, subType);
 
-            vector<User> filteredUsers = findUsersBySubscription(users, subType);
-            nlohmann::json j = usersToJson(filteredUsers);
+            RowBitmap rows = exportUsersBySubscription(session, subType);
 
-            writeJsonToFile(j,
-                "../frontend/flixhabit-frontend/public/data/" + subType + "_users.json");
-
-            if (filteredUsers.empty()) {
+            if (rows.empty()) {
                 cout << "No users found with " << subType << " subscription." << endl;
             }
             else {
                 cout << "Users with " << subType << " subscription:\n";
-                for (const auto& user : filteredUsers) {
+                rows.forEach([&](uint32_t row) {
+                    const User& user = users[row];
                     cout << "User ID: " << user.userID << ", Name: " << user.name
-                        << ", Country: " << user.country << ", Genre: " << user.genre << endl;
-                }
+                        << ", Country: " << user.country << ", Genre: " << user.genre
+                        << ", Age: " << user.age << ", Watch Time: " << user.watchTime << endl;
+                });
             }
             break;
         }
@@ -602,58 +940,32 @@ int main() {
             cout << "Process with:\n";
             cout << "1. Fixed-Size Min-Heap\n";  
             cout << "2. ActivityGraph\n";
+            cout << "3. Fixed-Size Min-Heap (parallel)\n";
+            cout << "4. Sorted watch-time index\n";
             cout << "Enter choice: ";
 
             int structureChoice;
             cin >> structureChoice;
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
 
-            vector<User> activeUsers; 
-
-            if (structureChoice == 1)
-            {
-                /* Measure the elapsed time of the dataset using FIXED SIZE HEAP */
-                /* Source: https://cplusplus.com/reference/chrono/high_resolution_clock/ */
-                auto heapStart = chrono::high_resolution_clock::now();
-                vector<User> heapResult = findMostActiveUsers(users, k);
-                activeUsers = heapResult;
-                auto heapFinish = chrono::high_resolution_clock::now();
-                auto heapUS = chrono::duration_cast<chrono::microseconds>(heapFinish - heapStart).count();
-
-                cout << "Processed user database in " << heapUS << " μs using a Min Heap." << endl;
-
-                for (auto& u : activeUsers)
-                   { cout << "User " << u.userID << " - " << u.watchTime << " h\n"; }
+            if (structureChoice < 1 || structureChoice > 4) {
+                cout << "Invalid choice. Please try again.\n";
+                break;
             }
-            else if (structureChoice == 2)
-            {
-                /* Find the index of the user with the highest watch time */
-                int highestWatch = 0;
-                for (int i = 1; i < (int)users.size(); ++i)
-                {
-                    if (users[i].watchTime > users[highestWatch].watchTime) { highestWatch = i; }
-                }
-
-                /* Measure the elapsed time of the dataset using GRAPH */
-                /* Source: https://cplusplus.com/reference/chrono/high_resolution_clock/ */
-                auto graphStart = chrono::high_resolution_clock::now();
-
-                /* Build the graph */
-                ActivityGraph ag = buildActivityGraph(users, highestWatch);
-
-                auto graphResult = ag.topKClosest(highestWatch, k);
-                auto graphFinish = chrono::high_resolution_clock::now();
-                auto graphUS = chrono::duration_cast<chrono::microseconds>(graphFinish - graphStart).count();
-
-                // 3) Map the indices back to User objects
-                activeUsers.clear();
-                activeUsers.reserve(graphResult.size());
+            const ActiveMethod methods[] = { ActiveMethod::Heap, ActiveMethod::Graph, ActiveMethod::ParallelHeap, ActiveMethod::Index };
+            ActiveMethod method = methods[structureChoice - 1];
 
-                for (int index : graphResult)
-                   { activeUsers.push_back(users[index]); }
+            /* Measure the elapsed time of the dataset with the chosen structure */
+            /* Source: https://cplusplus.com/reference/chrono/high_resolution_clock/ */
+            auto activeStart = chrono::high_resolution_clock::now();
+            vector<User> activeUsers = findActiveUsers(session, k, method);
+            auto activeFinish = chrono::high_resolution_clock::now();
+            auto activeUS = chrono::duration_cast<chrono::microseconds>(activeFinish - activeStart).count();
 
-                cout << "Processed user database in " << graphUS << " μs using a Graph." << endl;
+            cout << "Processed user database in " << activeUS << " μs using " << activeMethodDescription(method) << "." << endl;
 
+            if (method == ActiveMethod::Graph)
+            {
                 cout << "Most active users:\n";
                 for (const auto& user : activeUsers) 
                 {
@@ -662,13 +974,14 @@ int main() {
                         << ", Watch Time: " << user.watchTime 
                         << " hours, Genre: " << user.genre << endl;
                 }
-
+            }
+            else
+            {
+                for (auto& u : activeUsers)
+                   { cout << "User " << u.userID << " - " << u.watchTime << " h\n"; }
             }
 
-            nlohmann::json j = usersToJson(activeUsers);
-
-            writeJsonToFile(j,
-                "../frontend/flixhabit-frontend/public/data/topActive_users.json");
+            exportActiveUsers(session, activeUsers);
 
             break;
         }
@@ -689,7 +1002,217 @@ int main() {
             }
             break;
         }
+        case 10: {
+            if (users.empty()) {
+                cout << "No user data loaded. Please load data first." << endl;
+                break;
+            }
+
+            string keyList, aggregateList;
+            cout << "Group by (comma-separated: country, genre, subscription, month, ageBucket, age): ";
+            getline(cin, keyList);
+            cout << "Aggregates (comma-separated, e.g. count, avg:watchTime, max:age, mode:genre): ";
+            getline(cin, aggregateList);
+
+            GroupByQuery query;
+            try {
+                string token;
+                stringstream keys(keyList);
+                while (getline(keys, token, ',')) {
+                    token.erase(remove(token.begin(), token.end(), ' '), token.end());
+                    if (!token.empty()) query.keys.push_back(parseColumn(token));
+                }
+                stringstream aggregates(aggregateList);
+                while (getline(aggregates, token, ',')) {
+                    token.erase(remove(token.begin(), token.end(), ' '), token.end());
+                    if (!token.empty()) query.aggregates.push_back(parseAggregate(token));
+                }
+                if (query.aggregates.empty()) query.aggregates.push_back({ AggregateOp::Count });
+
+                GroupByResult result = groupBy(table, query);
+
+                for (Column key : query.keys) cout << columnName(key) << "\t";
+                for (const auto& agg : query.aggregates) cout << aggregateName(agg) << "\t";
+                cout << "\n";
+
+                for (const auto& row : result.rows) {
+                    for (size_t k = 0; k < query.keys.size(); ++k) {
+                        cout << columnLabel(table, query, query.keys[k], row.keys[k]) << "\t";
+                    }
+                    for (size_t a = 0; a < query.aggregates.size(); ++a) {
+                        if (query.aggregates[a].op == AggregateOp::Mode)
+                            cout << columnLabel(table, query, query.aggregates[a].column, (int)row.values[a]) << "\t";
+                        else
+                            cout << row.values[a] << "\t";
+                    }
+                    cout << "\n";
+                }
+            }
+            catch (const invalid_argument& e) {
+                cout << "Invalid breakdown: " << e.what() << endl;
+            }
+            break;
+        }
+        case 11: {
+            if (users.empty()) {
+                cout << "No user data loaded. Please load data first." << endl;
+                break;
+            }
+
+            string filterList;
+            cout << "Enter filters (e.g. subscription=Premium, country=USA, age=25..34, watchTime=500..900): ";
+            getline(cin, filterList);
+
+            try {
+                vector<RowFilter> filters;
+                bool unknownValue = false;
+
+                string token;
+                stringstream ss(filterList);
+                while (getline(ss, token, ',')) {
+                    token.erase(remove(token.begin(), token.end(), ' '), token.end());
+                    size_t eq = token.find('=');
+                    if (eq == string::npos) {
+                        if (!token.empty()) throw invalid_argument("Expected column=value, got " + token);
+                        continue;
+                    }
+
+                    Column column = parseColumn(token.substr(0, eq));
+                    string value = token.substr(eq + 1);
+
+                    // Age and watch time take a range lo..hi or a single value
+                    if (column == Column::Age || column == Column::WatchTime) {
+                        size_t dots = value.find("..");
+                        double lo = stod(value.substr(0, dots));
+                        double hi = dots == string::npos ? lo : stod(value.substr(dots + 2));
+                        filters.push_back(RowFilter::between(column, lo, hi));
+                        continue;
+                    }
+
+                    int code = column == Column::Country      ? table.countries.find(value)
+                             : column == Column::Subscription ? table.subscriptions.find(value)
+                             : column == Column::Genre        ? table.genres.find(value)
+                             : throw invalid_argument(columnName(column) + " has no index");
+
+                    if (code < 0) unknownValue = true;
+                    else filters.push_back(RowFilter::equals(column, code));
+                }
+
+                auto filterStart = chrono::high_resolution_clock::now();
+                shared_ptr<const RowBitmap> selected = unknownValue ? make_shared<const RowBitmap>() : index.select(table, filters);
+                const RowBitmap& rows = *selected;
+                auto filterFinish = chrono::high_resolution_clock::now();
+                auto filterUS = chrono::duration_cast<chrono::microseconds>(filterFinish - filterStart).count();
+
+                cout << rows.cardinality() << " matching users, filtered in " << filterUS << " μs using bitmap and sorted indexes." << endl;
+
+                const uint64_t SHOWN = 20;
+                uint64_t shown = 0;
+                rows.forEach([&](uint32_t row) {
+                    if (shown++ >= SHOWN) return;
+                    const User& user = users[row];
+                    cout << "User ID: " << user.userID << ", Name: " << user.name << ", Subscription: " << user.subscription
+                        << ", Country: " << user.country << ", Genre: " << user.genre
+                        << ", Age: " << user.age << ", Watch Time: " << user.watchTime << endl;
+                });
+                if (shown > SHOWN) cout << "... and " << shown - SHOWN << " more\n";
+            }
+            catch (const invalid_argument& e) {
+                cout << "Invalid filter: " << e.what() << endl;
+            }
+            break;
+        }
+        case 12: {
+            if (!users.empty()) {
+                cout << "All " << users.size() << " users exported in each format:\n";
+                compareExportFormats(users);
+            }
+
+            string formatName;
+            cout << "Enter export format (json, compact, ndjson, cbor, msgpack) [" << exportFormatName(exporter.format) << "]: ";
+            getline(cin, formatName);
+
+            string gzipAnswer;
+            cout << "Also write .gz copies? (y/n) [" << (exporter.compressor ? "y" : "n") << "]: ";
+            getline(cin, gzipAnswer);
+            if (gzipAnswer == "y" || gzipAnswer == "Y") exporter.compressor = &compressor;
+            if (gzipAnswer == "n" || gzipAnswer == "N") exporter.compressor = nullptr;
+
+            string pageAnswer;
+            cout << "Users per page for subscription exports, 0 for one file [" << exporter.pageSize << "]: ";
+            getline(cin, pageAnswer);
+
+            try {
+                if (!formatName.empty()) exporter.format = parseExportFormat(formatName);
+                if (!pageAnswer.empty()) exporter.pageSize = stoul(pageAnswer);
+            }
+            catch (const invalid_argument& e) {
+                cout << e.what() << endl;
+            }
+
+            cout << "Exports will be written as " << exportFormatName(exporter.format)
+                 << " (" << exportFormatExtension(exporter.format) << " files)"
+                 << (exporter.compressor ? " with .gz copies" : "")
+                 << (exporter.pageSize > 0 ? ", subscription lists in pages of " + to_string(exporter.pageSize) + " users." : ".") << endl;
+            if (compressor.getFilesDone() > 0) {
+                cout << compressor.getFilesDone() << " files compressed so far, " << compressor.getBytesIn() << " bytes -> "
+                     << compressor.getBytesOut() << " bytes";
+                if (compressor.pending() > 0) cout << ", " << compressor.pending() << " still in progress";
+                cout << "." << endl;
+            }
+            cout << "Exports changed " << session.etags.getGeneration() << " times (etags.json generation)." << endl;
+            break;
+        }
+        case 13: {
+            if (users.empty()) {
+                cout << "No user data loaded. Please load data first." << endl;
+                break;
+            }
+
+            string answer;
+            unsigned int similarK = 10, activeK = 10;
+            try {
+                cout << "Similar user pairs [" << similarK << "]: ";
+                getline(cin, answer);
+                if (!answer.empty()) similarK = stoul(answer);
+                cout << "Most active users [" << activeK << "]: ";
+                getline(cin, answer);
+                if (!answer.empty()) activeK = stoul(answer);
+            }
+            catch (const logic_error&) {
+                cout << "Expected a number." << endl;
+                break;
+            }
+
+            exportDashboard(session, similarK, activeK);
+            break;
+        }
+        case 14: {
+            if (users.empty()) {
+                cout << "No user data loaded. Please load data first." << endl;
+                break;
+            }
+
+            string answer;
+            vector<unsigned int> windows = { 7, 30, 90 };
+            cout << "Windows in days, comma-separated [7,30,90]: ";
+            getline(cin, answer);
+            try {
+                if (!answer.empty()) windows = parseWindows("Windows", answer);
+            }
+            catch (const invalid_argument& e) {
+                cout << e.what() << endl;
+                break;
+            }
+
+            printRecency(exportRecency(session, windows), table);
+            break;
+        }
         case 0:
+            if (compressor.pending() > 0) {
+                cout << "Finishing " << compressor.pending() << " compressed exports..." << endl;
+                compressor.wait();
+            }
             cout << "Exiting program. Goodbye!\n";
             break;
         default:
@@ -699,3 +1222,51 @@ int main() {
 
     return 0;
 }
+
+// Write the spans recorded during the run to a Chrome trace file and print the per-phase summary
+void writeTrace(const string& path) {
+    ofstream out(path);
+    Trace::writeChromeTrace(out);
+    if (!out) {
+        cerr << "Cannot write the trace to " << path << endl;
+        return;
+    }
+    cout << "\nTrace written to " << path << " (open it in chrome://tracing or ui.perfetto.dev)\n";
+    Trace::writeSummary(cout);
+}
+
+// Main function - entry point for the application: the menu, or with arguments, a batch of commands
+int main(int argc, char* argv[]) {
+    vector<string> args(argv + 1, argv + argc);
+
+    // --trace <file.json> and --memory, in either order ahead of everything else, measure the whole run
+    string tracePath;
+    bool memory = false;
+    while (!args.empty()) {
+        if (args.size() >= 2 && args[0] == "--trace") {
+            tracePath = args[1];
+            args.erase(args.begin(), args.begin() + 2);
+            Trace::enable();
+            Trace::setThreadName("main");
+        }
+        else if (args[0] == "--memory") {
+            memory = true;
+            args.erase(args.begin());
+            MemoryStats::enable();
+        }
+        else break;
+    }
+
+    int status;
+    {
+        Session session;   // closing it waits for the .gz copies, so their compression is in the trace too
+        status = args.empty() ? runMenu(session) : runBatch(session, args);
+    }
+
+    if (!tracePath.empty()) writeTrace(tracePath);
+    if (memory) {
+        cout << "\nMemory per operation (heap figures count operator new; RSS from /proc/self/status):\n";
+        MemoryScope::writeReport(cout);
+    }
+    return status;
+}